@@ -0,0 +1,1383 @@
+/**
+ * This program picks the partitioning plan automatically from a small cost model.
+ * The cache sizes and TLB entries of the machine are read from sysfs/CPUID and the per-tuple cost of every
+ * partitioning kernel is calibrated at startup (or loaded from a calibration file saved by an earlier run).
+ * The model then predicts the running time of every candidate plan (concurrent-output, two-pass and multi-pass,
+ * with direct or write-combining buffered scattering) and runs the cheapest one.
+ * The chosen plan is logged together with its predicted and actual time.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param calibration_file (optional) The file to load the calibration from. It is written if it does not exist.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <tuple>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "auto-partition";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// Number of tuples staged per bucket before a buffered scatter writes them out (one 64 byte cache line)
+const int TUPLES_PER_CACHE_LINE = 4;
+
+// Number of tuples used when calibrating the cost model
+const int CALIBRATION_SIZE = 1 << 21;
+
+// Largest number of passes considered by the multi-pass plans
+const int MAX_PASSES = 3;
+
+// Version of the calibration file format, bumped whenever the set of calibrated values changes
+const int CALIBRATION_VERSION = 1;
+
+/**
+ * The hardware parameters the cost model is based on.
+ */
+struct HardwareInfo
+{
+  int num_cores;
+  int cache_line_size;
+  long l1_size;
+  long l2_size;
+  long l3_size;
+  int l1_tlb_entries;
+  int l2_tlb_entries;
+};
+
+/**
+ * The calibrated per-tuple costs of the partitioning kernels.
+ * The fanout dependent costs are measured at the fanouts in fanout_bits and interpolated in between.
+ */
+struct Calibration
+{
+  string signature;
+  double copy_gbps;
+  double contention_ns;
+  vector<int> fanout_bits;
+  vector<double> count_ns;
+  vector<double> atomic_scatter_ns;
+  vector<double> direct_scatter_ns;
+  vector<double> buffered_scatter_ns;
+};
+
+enum Algorithm
+{
+  CONCURRENT_OUTPUT,
+  TWO_PASS,
+  MULTI_PASS
+};
+
+/**
+ * A partitioning plan is the algorithm, the number of passes and the buffering strategy.
+ */
+struct Plan
+{
+  Algorithm algorithm;
+  int passes;
+  bool buffered;
+  double predicted_ms;
+};
+
+/**
+ * The result of a partitioning. Bucket i holds the tuples output[bucket_start[i]] to
+ * output[bucket_start[i] + bucket_size[i] - 1].
+ */
+struct PartitionResult
+{
+  vector<tuple<int64_t, int64_t>> output;
+  vector<int> bucket_start;
+  vector<int> bucket_size;
+};
+
+/**
+ * Get the data given a number.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Get the partition of a number within a single pass of a multi-pass partitioning.
+ * A pass partitions on the bits [shift, shift + log2(fanout)) of the final partition.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The final number of buckets.
+ * @param shift The lowest partition bit used by the pass.
+ * @param fanout The number of partitions created by the pass.
+ * @return The partition for the number within the pass.
+ */
+int get_pass_partition(int64_t n, int num_of_buckets, int shift, int fanout)
+{
+  return (get_partition(n, num_of_buckets) >> shift) & (fanout - 1);
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Read a single line from a file.
+ * @param path The path of the file.
+ * @return The first line of the file, or an empty string if it could not be read.
+ */
+string read_sysfs_line(const string &path)
+{
+  ifstream file(path);
+  string line;
+  if (file.is_open())
+  {
+    getline(file, line);
+  }
+  return line;
+}
+
+/**
+ * Parse a sysfs size such as "48K" or "2M" into bytes.
+ * @param size The size to parse.
+ * @return The size in bytes, or 0 if it could not be parsed.
+ */
+long parse_sysfs_size(const string &size)
+{
+  if (size.empty())
+  {
+    return 0;
+  }
+  long value = atol(size.c_str());
+  switch (size[size.size() - 1])
+  {
+  case 'K':
+    return value << 10;
+  case 'M':
+    return value << 20;
+  case 'G':
+    return value << 30;
+  default:
+    return value;
+  }
+}
+
+/**
+ * Read the data TLB entries for 4 KB pages using CPUID.
+ * Intel reports them in leaf 0x18 and AMD in leaves 0x80000005 and 0x80000006.
+ * @param info The hardware info to fill in. Entries that cannot be read are left untouched.
+ */
+void read_tlb_entries(HardwareInfo &info)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid_count(0x18, 0, &eax, &ebx, &ecx, &edx))
+  {
+    unsigned int max_subleaf = eax;
+    for (unsigned int subleaf = 0; subleaf <= max_subleaf; subleaf++)
+    {
+      __get_cpuid_count(0x18, subleaf, &eax, &ebx, &ecx, &edx);
+      int type = edx & 0x1f;
+      int level = (edx >> 5) & 0x7;
+      bool supports_4k = ebx & 0x1;
+      int entries = ((ebx >> 16) & 0xffff) * ecx;
+      // 1: data TLB, 3: unified TLB, 4: load-only TLB
+      if (!supports_4k || !(type == 1 || type == 3 || type == 4))
+      {
+        continue;
+      }
+      if (level == 1)
+      {
+        info.l1_tlb_entries = max(info.l1_tlb_entries, entries);
+      }
+      else if (level == 2)
+      {
+        info.l2_tlb_entries = max(info.l2_tlb_entries, entries);
+      }
+    }
+  }
+  else if (__get_cpuid(0x80000005, &eax, &ebx, &ecx, &edx))
+  {
+    info.l1_tlb_entries = (ebx >> 16) & 0xff;
+    if (__get_cpuid(0x80000006, &eax, &ebx, &ecx, &edx))
+    {
+      info.l2_tlb_entries = (ebx >> 16) & 0xfff;
+    }
+  }
+#endif
+}
+
+/**
+ * Read the hardware parameters of the machine from sysfs and CPUID.
+ * Reasonable defaults are used for anything that cannot be read.
+ * @return The hardware info.
+ */
+HardwareInfo read_hardware_info()
+{
+  HardwareInfo info;
+  info.num_cores = thread::hardware_concurrency();
+  info.cache_line_size = 64;
+  info.l1_size = 32 << 10;
+  info.l2_size = 1 << 20;
+  info.l3_size = 32 << 20;
+  info.l1_tlb_entries = 0;
+  info.l2_tlb_entries = 0;
+
+  for (int index = 0; index < 8; index++)
+  {
+    string dir = "/sys/devices/system/cpu/cpu0/cache/index" + to_string(index) + "/";
+    string type = read_sysfs_line(dir + "type");
+    if (type.empty())
+    {
+      break;
+    }
+    if (type == "Instruction")
+    {
+      continue;
+    }
+    int level = atoi(read_sysfs_line(dir + "level").c_str());
+    long size = parse_sysfs_size(read_sysfs_line(dir + "size"));
+    int line_size = atoi(read_sysfs_line(dir + "coherency_line_size").c_str());
+    if (line_size > 0)
+    {
+      info.cache_line_size = line_size;
+    }
+    if (size <= 0)
+    {
+      continue;
+    }
+    if (level == 1)
+    {
+      info.l1_size = size;
+    }
+    else if (level == 2)
+    {
+      info.l2_size = size;
+    }
+    else if (level == 3)
+    {
+      info.l3_size = size;
+    }
+  }
+
+  read_tlb_entries(info);
+  if (info.l1_tlb_entries == 0)
+  {
+    info.l1_tlb_entries = 64;
+  }
+  if (info.l2_tlb_entries == 0)
+  {
+    info.l2_tlb_entries = 1536;
+  }
+  return info;
+}
+
+/**
+ * Get a signature of the hardware so that a calibration is only reused on the machine it was made on.
+ * @param info The hardware info.
+ * @return The signature.
+ */
+string get_hardware_signature(const HardwareInfo &info)
+{
+  stringstream signature;
+  signature << "v" << CALIBRATION_VERSION << "-" << info.num_cores << "c-" << info.l1_size << "-" << info.l2_size
+            << "-" << info.l3_size << "-" << info.l1_tlb_entries << "-" << info.l2_tlb_entries;
+  return signature.str();
+}
+
+/**
+ * Count the number of tuples going to each partition of a pass.
+ * @param data The data to count.
+ * @param start The start index of the range.
+ * @param end The end index of the range.
+ * @param num_of_buckets The final number of buckets.
+ * @param shift The lowest partition bit used by the pass.
+ * @param fanout The number of partitions created by the pass.
+ * @param histogram The histogram to add the counts to.
+ */
+void count_range(const tuple<int64_t, int64_t> *data, int start, int end, int num_of_buckets, int shift,
+                 int fanout, int *histogram)
+{
+  for (int j = start; j < end; j++)
+  {
+    histogram[get_pass_partition(get<0>(data[j]), num_of_buckets, shift, fanout)]++;
+  }
+}
+
+/**
+ * Scatter tuples directly to their destinations given the write offset of every partition.
+ * @param data The data to scatter.
+ * @param start The start index of the range.
+ * @param end The end index of the range.
+ * @param num_of_buckets The final number of buckets.
+ * @param shift The lowest partition bit used by the pass.
+ * @param fanout The number of partitions created by the pass.
+ * @param offsets The write offset of every partition. Advanced as tuples are written.
+ * @param output The output to scatter to.
+ */
+void scatter_range_direct(const tuple<int64_t, int64_t> *data, int start, int end, int num_of_buckets, int shift,
+                          int fanout, int *offsets, tuple<int64_t, int64_t> *output)
+{
+  for (int j = start; j < end; j++)
+  {
+    int partition = get_pass_partition(get<0>(data[j]), num_of_buckets, shift, fanout);
+    output[offsets[partition]++] = data[j];
+  }
+}
+
+/**
+ * Scatter tuples through a cache line sized write-combining buffer per partition.
+ * Writes are batched per partition: a full buffer is copied out as one cache line, so the destination of a partition
+ * is touched once per line instead of once per tuple.
+ * @param data The data to scatter.
+ * @param start The start index of the range.
+ * @param end The end index of the range.
+ * @param num_of_buckets The final number of buckets.
+ * @param shift The lowest partition bit used by the pass.
+ * @param fanout The number of partitions created by the pass.
+ * @param offsets The write offset of every partition. Advanced as tuples are written.
+ * @param output The output to scatter to.
+ */
+void scatter_range_buffered(const tuple<int64_t, int64_t> *data, int start, int end, int num_of_buckets, int shift,
+                            int fanout, int *offsets, tuple<int64_t, int64_t> *output)
+{
+  vector<tuple<int64_t, int64_t>> staging(fanout * TUPLES_PER_CACHE_LINE);
+  vector<int> staged(fanout, 0);
+
+  for (int j = start; j < end; j++)
+  {
+    int partition = get_pass_partition(get<0>(data[j]), num_of_buckets, shift, fanout);
+    tuple<int64_t, int64_t> *line = &staging[partition * TUPLES_PER_CACHE_LINE];
+    line[staged[partition]++] = data[j];
+    if (staged[partition] == TUPLES_PER_CACHE_LINE)
+    {
+      copy(line, line + TUPLES_PER_CACHE_LINE, output + offsets[partition]);
+      offsets[partition] += TUPLES_PER_CACHE_LINE;
+      staged[partition] = 0;
+    }
+  }
+
+  // Flush what is left in the buffers
+  for (int partition = 0; partition < fanout; partition++)
+  {
+    tuple<int64_t, int64_t> *line = &staging[partition * TUPLES_PER_CACHE_LINE];
+    copy(line, line + staged[partition], output + offsets[partition]);
+    offsets[partition] += staged[partition];
+  }
+}
+
+/**
+ * Scatter tuples to fixed capacity buckets using a shared atomic counter per bucket.
+ * This is the kernel of concurrent-output.
+ * @param counter The counter of every bucket.
+ * @param data The data to scatter.
+ * @param start The start index of the range.
+ * @param end The end index of the range.
+ * @param num_of_buckets The number of buckets.
+ * @param bucket_capacity The capacity of every bucket.
+ * @param output The output to scatter to.
+ */
+void scatter_range_atomic(vector<atomic<int>> &counter, const tuple<int64_t, int64_t> *data, int start, int end,
+                          int num_of_buckets, int bucket_capacity, tuple<int64_t, int64_t> *output)
+{
+  for (int j = start; j < end; j++)
+  {
+    int partition = get_partition(get<0>(data[j]), num_of_buckets);
+    output[(int64_t)partition * bucket_capacity + counter[partition]++] = data[j];
+  }
+}
+
+/**
+ * Count a chunk of data with affinity to a specific CPU core.
+ * @param thread_id The id of the thread.
+ * @param data The data to count.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param num_of_buckets The final number of buckets.
+ * @param shift The lowest partition bit used by the pass.
+ * @param fanout The number of partitions created by the pass.
+ * @param histogram The histogram of the thread.
+ */
+void count_chunk(int thread_id, const tuple<int64_t, int64_t> *data, int start, int end, int num_of_buckets,
+                 int shift, int fanout, vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  count_range(data, start, end, num_of_buckets, shift, fanout, histogram.data());
+}
+
+/**
+ * Scatter a chunk of data with affinity to a specific CPU core.
+ * @param thread_id The id of the thread.
+ * @param data The data to scatter.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param num_of_buckets The final number of buckets.
+ * @param shift The lowest partition bit used by the pass.
+ * @param fanout The number of partitions created by the pass.
+ * @param offsets The write offsets of the thread.
+ * @param output The output to scatter to.
+ * @param buffered Whether to scatter through write-combining buffers.
+ */
+void scatter_chunk(int thread_id, const tuple<int64_t, int64_t> *data, int start, int end, int num_of_buckets,
+                   int shift, int fanout, vector<int> &offsets, tuple<int64_t, int64_t> *output, bool buffered)
+{
+  pin_thread(thread_id);
+  if (buffered)
+  {
+    scatter_range_buffered(data, start, end, num_of_buckets, shift, fanout, offsets.data(), output);
+  }
+  else
+  {
+    scatter_range_direct(data, start, end, num_of_buckets, shift, fanout, offsets.data(), output);
+  }
+}
+
+/**
+ * Scatter a chunk of data with atomic counters with affinity to a specific CPU core.
+ * @param counter The counter of every bucket.
+ * @param thread_id The id of the thread.
+ * @param data The data to scatter.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param num_of_buckets The number of buckets.
+ * @param bucket_capacity The capacity of every bucket.
+ * @param output The output to scatter to.
+ */
+void atomic_scatter_chunk(vector<atomic<int>> &counter, int thread_id, const tuple<int64_t, int64_t> *data, int start,
+                          int end, int num_of_buckets, int bucket_capacity, tuple<int64_t, int64_t> *output)
+{
+  pin_thread(thread_id);
+  scatter_range_atomic(counter, data, start, end, num_of_buckets, bucket_capacity, output);
+}
+
+/**
+ * Partition the data with shared atomic counters in a single pass (concurrent-output).
+ * Every bucket gets a fixed capacity of data_size / num_of_buckets + 1 tuples like in concurrent-output.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads to use.
+ * @param num_of_buckets The number of buckets.
+ * @return The partitioned data.
+ */
+PartitionResult run_concurrent_output(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads,
+                                      int num_of_buckets)
+{
+  int data_size = data.size();
+  int bucket_capacity = data_size / num_of_buckets + 1;
+  PartitionResult result;
+  result.output.resize((int64_t)bucket_capacity * num_of_buckets);
+
+  vector<atomic<int>> counter(num_of_buckets);
+  for (int i = 0; i < num_of_buckets; i++)
+  {
+    counter[i] = 0;
+  }
+
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(atomic_scatter_chunk, ref(counter), i, data.data(), start, end, num_of_buckets,
+                             bucket_capacity, result.output.data()));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  for (int i = 0; i < num_of_buckets; i++)
+  {
+    result.bucket_start.push_back(i * bucket_capacity);
+    result.bucket_size.push_back(counter[i]);
+  }
+  return result;
+}
+
+/**
+ * Run one parallel count-then-scatter pass over the whole input.
+ * Every thread counts its chunk into its own histogram, the histograms are turned into per thread write offsets
+ * and every thread then scatters its chunk without any synchronisation.
+ * @param input The data to partition.
+ * @param output The output to scatter to.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads to use.
+ * @param num_of_buckets The final number of buckets.
+ * @param shift The lowest partition bit used by the pass.
+ * @param fanout The number of partitions created by the pass.
+ * @param buffered Whether to scatter through write-combining buffers.
+ * @return The start offset of every partition followed by the data size.
+ */
+vector<int> run_parallel_pass(const tuple<int64_t, int64_t> *input, tuple<int64_t, int64_t> *output, int data_size,
+                              int num_of_threads, int num_of_buckets, int shift, int fanout, bool buffered)
+{
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(fanout, 0));
+
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, i, input, start, end, num_of_buckets, shift, fanout, ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  // Turn the histograms into write offsets. Partition p of thread i starts after partition p of threads 0..i-1.
+  vector<int> partition_start(fanout + 1, 0);
+  int offset = 0;
+  for (int p = 0; p < fanout; p++)
+  {
+    partition_start[p] = offset;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][p];
+      histograms[i][p] = offset;
+      offset += count;
+    }
+  }
+  partition_start[fanout] = offset;
+
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk, i, input, start, end, num_of_buckets, shift, fanout, ref(histograms[i]),
+                             output, buffered));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+  return partition_start;
+}
+
+/**
+ * Split the hash bits into the number of bits used by each pass, most significant pass first.
+ * @param num_of_hashbits The number of hash bits.
+ * @param passes The number of passes.
+ * @return The number of bits of each pass.
+ */
+vector<int> split_hashbits(int num_of_hashbits, int passes)
+{
+  vector<int> bits(passes, num_of_hashbits / passes);
+  for (int i = 0; i < num_of_hashbits % passes; i++)
+  {
+    bits[i]++;
+  }
+  return bits;
+}
+
+/**
+ * Refine every range of the input by one more pass. Ranges are handed out to the threads dynamically and every
+ * range is counted and scattered by a single thread.
+ * @param thread_id The id of the thread.
+ * @param next_range The index of the next range to refine, shared by all threads.
+ * @param ranges The start offsets of the ranges followed by the data size.
+ * @param input The data to partition.
+ * @param output The output to scatter to.
+ * @param num_of_buckets The final number of buckets.
+ * @param shift The lowest partition bit used by the pass.
+ * @param fanout The number of partitions created in every range by the pass.
+ * @param buffered Whether to scatter through write-combining buffers.
+ * @param refined The start offsets of the refined ranges, written for the ranges processed by this thread.
+ */
+void refine_ranges(int thread_id, atomic<int> &next_range, const vector<int> &ranges,
+                   const tuple<int64_t, int64_t> *input, tuple<int64_t, int64_t> *output, int num_of_buckets, int shift,
+                   int fanout, bool buffered, vector<int> &refined)
+{
+  pin_thread(thread_id);
+  int num_of_ranges = ranges.size() - 1;
+  vector<int> offsets(fanout);
+
+  for (int r = next_range++; r < num_of_ranges; r = next_range++)
+  {
+    fill(offsets.begin(), offsets.end(), 0);
+    count_range(input, ranges[r], ranges[r + 1], num_of_buckets, shift, fanout, offsets.data());
+
+    int offset = ranges[r];
+    for (int p = 0; p < fanout; p++)
+    {
+      int count = offsets[p];
+      offsets[p] = offset;
+      refined[r * fanout + p] = offset;
+      offset += count;
+    }
+
+    if (buffered)
+    {
+      scatter_range_buffered(input, ranges[r], ranges[r + 1], num_of_buckets, shift, fanout, offsets.data(), output);
+    }
+    else
+    {
+      scatter_range_direct(input, ranges[r], ranges[r + 1], num_of_buckets, shift, fanout, offsets.data(), output);
+    }
+  }
+}
+
+/**
+ * Partition the data with one or more count-then-scatter passes.
+ * The first pass is split over the input between the threads, the later passes refine the ranges of the previous
+ * pass with one thread per range. With a single pass this is the classic two-pass partitioning.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads to use.
+ * @param num_of_hashbits The number of hash bits.
+ * @param passes The number of passes.
+ * @param buffered Whether to scatter through write-combining buffers.
+ * @return The partitioned data.
+ */
+PartitionResult run_multi_pass(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads, int num_of_hashbits,
+                               int passes, bool buffered)
+{
+  int data_size = data.size();
+  int num_of_buckets = 1 << num_of_hashbits;
+  vector<int> bits = split_hashbits(num_of_hashbits, passes);
+
+  PartitionResult result;
+  vector<tuple<int64_t, int64_t>> scratch(passes > 1 ? data_size : 0);
+  // Ping-pong between the two arrays so that the last pass writes to the output
+  result.output.resize(data_size);
+  tuple<int64_t, int64_t> *targets[2] = {result.output.data(), scratch.data()};
+  int target = (passes - 1) % 2;
+
+  int shift = num_of_hashbits - bits[0];
+  vector<int> ranges = run_parallel_pass(data.data(), targets[target], data_size, num_of_threads, num_of_buckets,
+                                         shift, 1 << bits[0], buffered);
+
+  for (int pass = 1; pass < passes; pass++)
+  {
+    shift -= bits[pass];
+    int fanout = 1 << bits[pass];
+    int num_of_ranges = ranges.size() - 1;
+    vector<int> refined(num_of_ranges * fanout + 1, data_size);
+    atomic<int> next_range(0);
+
+    vector<thread> threads;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      threads.push_back(thread(refine_ranges, i, ref(next_range), cref(ranges), targets[target],
+                               targets[1 - target], num_of_buckets, shift, fanout, buffered, ref(refined)));
+    }
+    for (auto &t : threads)
+    {
+      t.join();
+    }
+
+    ranges.swap(refined);
+    target = 1 - target;
+  }
+
+  for (int i = 0; i < num_of_buckets; i++)
+  {
+    result.bucket_start.push_back(ranges[i]);
+    result.bucket_size.push_back(ranges[i + 1] - ranges[i]);
+  }
+  return result;
+}
+
+/**
+ * Run a plan.
+ * @param plan The plan to run.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads to use.
+ * @param num_of_hashbits The number of hash bits.
+ * @return The partitioned data.
+ */
+PartitionResult run_plan(const Plan &plan, const vector<tuple<int64_t, int64_t>> &data, int num_of_threads,
+                         int num_of_hashbits)
+{
+  if (plan.algorithm == CONCURRENT_OUTPUT)
+  {
+    return run_concurrent_output(data, num_of_threads, 1 << num_of_hashbits);
+  }
+  return run_multi_pass(data, num_of_threads, num_of_hashbits, plan.passes, plan.buffered);
+}
+
+/**
+ * Measure the time per tuple of a kernel in nanoseconds.
+ * @param kernel The kernel to measure.
+ * @param num_of_tuples The number of tuples processed by one run of the kernel.
+ * @return The best time per tuple out of a few runs.
+ */
+template <typename Kernel>
+double time_per_tuple_ns(Kernel kernel, int num_of_tuples)
+{
+  double best = 1e30;
+  for (int run = 0; run < 3; run++)
+  {
+    auto start_time = high_resolution_clock::now();
+    kernel();
+    auto end_time = high_resolution_clock::now();
+    best = min(best, duration<double, nano>(end_time - start_time).count() / num_of_tuples);
+  }
+  return best;
+}
+
+/**
+ * Get the fanouts the kernels are calibrated at. The fanouts where the partitions stop fitting into the TLBs and
+ * the caches are added to a regular grid so that the interpolation follows the steps in the cost.
+ * @param info The hardware info.
+ * @return The calibrated fanouts as a number of bits.
+ */
+vector<int> get_calibration_fanout_bits(const HardwareInfo &info)
+{
+  vector<int> fanout_bits;
+  for (int bits = 1; (1 << bits) <= MAX_BUCKETS; bits += 3)
+  {
+    fanout_bits.push_back(bits);
+  }
+  long thresholds[] = {info.l1_tlb_entries, info.l2_tlb_entries, info.l1_size / info.cache_line_size,
+                       info.l2_size / info.cache_line_size};
+  for (long threshold : thresholds)
+  {
+    for (int bits = 1; (1 << bits) <= MAX_BUCKETS; bits++)
+    {
+      if ((1L << bits) >= threshold)
+      {
+        fanout_bits.push_back(bits);
+        if ((1 << (bits + 1)) <= MAX_BUCKETS)
+        {
+          fanout_bits.push_back(bits + 1);
+        }
+        break;
+      }
+    }
+  }
+  for (int bits = 1; (1 << bits) <= MAX_BUCKETS; bits++)
+  {
+    if ((1 << bits) == MAX_BUCKETS)
+    {
+      fanout_bits.push_back(bits);
+    }
+  }
+  sort(fanout_bits.begin(), fanout_bits.end());
+  fanout_bits.erase(unique(fanout_bits.begin(), fanout_bits.end()), fanout_bits.end());
+  return fanout_bits;
+}
+
+/**
+ * Measure the sequential copy bandwidth of the machine using all cores.
+ * @param num_of_cores The number of cores.
+ * @return The bandwidth in GB/s, counting both the bytes read and the bytes written.
+ */
+double measure_copy_bandwidth(int num_of_cores)
+{
+  const int num_of_tuples = 1 << 23;
+  vector<tuple<int64_t, int64_t>> source = get_data_given_n(num_of_tuples);
+  vector<tuple<int64_t, int64_t>> destination(num_of_tuples);
+  int chunk_size = compute_input_chunk_size(num_of_tuples, num_of_cores);
+
+  double ns = time_per_tuple_ns([&]() {
+    vector<thread> threads;
+    for (int i = 0; i < num_of_cores; i++)
+    {
+      int start = i * chunk_size;
+      int end = (i == num_of_cores - 1) ? num_of_tuples : start + chunk_size;
+      threads.push_back(thread([&, i, start, end]() {
+        pin_thread(i);
+        copy(source.begin() + start, source.begin() + end, destination.begin() + start);
+      }));
+    }
+    for (auto &t : threads)
+    {
+      t.join();
+    }
+  }, num_of_tuples);
+  return 2 * sizeof(tuple<int64_t, int64_t>) / ns;
+}
+
+/**
+ * Measure the extra cost of an atomic increment when all cores hit the same counter.
+ * @param num_of_cores The number of cores.
+ * @return The extra cost per increment in nanoseconds.
+ */
+double measure_contention(int num_of_cores)
+{
+  if (num_of_cores < 2)
+  {
+    return 0;
+  }
+  const int increments = 1 << 20;
+  atomic<int> shared(0);
+  double uncontended = time_per_tuple_ns([&]() {
+    for (int j = 0; j < increments; j++)
+    {
+      shared++;
+    }
+  }, increments);
+
+  double contended = time_per_tuple_ns([&]() {
+    vector<thread> threads;
+    for (int i = 0; i < num_of_cores; i++)
+    {
+      threads.push_back(thread([&, i]() {
+        pin_thread(i);
+        for (int j = 0; j < increments / num_of_cores; j++)
+        {
+          shared++;
+        }
+      }));
+    }
+    for (auto &t : threads)
+    {
+      t.join();
+    }
+  }, increments);
+
+  // The contended run is spread over all cores, so scale it back to the time one core spends per increment
+  return max(0.0, contended * num_of_cores - uncontended);
+}
+
+/**
+ * Calibrate the cost model by timing every kernel single threaded at a range of fanouts.
+ * @param info The hardware info.
+ * @return The calibration.
+ */
+Calibration calibrate(const HardwareInfo &info)
+{
+  Calibration calibration;
+  calibration.signature = get_hardware_signature(info);
+  calibration.fanout_bits = get_calibration_fanout_bits(info);
+
+  vector<tuple<int64_t, int64_t>> data = get_data_given_n(CALIBRATION_SIZE);
+  vector<tuple<int64_t, int64_t>> output(CALIBRATION_SIZE + MAX_BUCKETS);
+
+  for (int bits : calibration.fanout_bits)
+  {
+    int fanout = 1 << bits;
+    vector<int> histogram(fanout);
+    vector<int> offsets(fanout);
+
+    calibration.count_ns.push_back(time_per_tuple_ns([&]() {
+      fill(histogram.begin(), histogram.end(), 0);
+      count_range(data.data(), 0, CALIBRATION_SIZE, fanout, 0, fanout, histogram.data());
+    }, CALIBRATION_SIZE));
+
+    auto reset_offsets = [&]() {
+      int offset = 0;
+      for (int p = 0; p < fanout; p++)
+      {
+        offsets[p] = offset;
+        offset += histogram[p];
+      }
+    };
+    calibration.direct_scatter_ns.push_back(time_per_tuple_ns([&]() {
+      reset_offsets();
+      scatter_range_direct(data.data(), 0, CALIBRATION_SIZE, fanout, 0, fanout, offsets.data(), output.data());
+    }, CALIBRATION_SIZE));
+    calibration.buffered_scatter_ns.push_back(time_per_tuple_ns([&]() {
+      reset_offsets();
+      scatter_range_buffered(data.data(), 0, CALIBRATION_SIZE, fanout, 0, fanout, offsets.data(), output.data());
+    }, CALIBRATION_SIZE));
+
+    vector<atomic<int>> counter(fanout);
+    calibration.atomic_scatter_ns.push_back(time_per_tuple_ns([&]() {
+      for (int p = 0; p < fanout; p++)
+      {
+        counter[p] = 0;
+      }
+      scatter_range_atomic(counter, data.data(), 0, CALIBRATION_SIZE, fanout, CALIBRATION_SIZE / fanout + 1,
+                           output.data());
+    }, CALIBRATION_SIZE));
+  }
+
+  calibration.copy_gbps = measure_copy_bandwidth(info.num_cores);
+  calibration.contention_ns = measure_contention(info.num_cores);
+  return calibration;
+}
+
+/**
+ * Write a list of values as a single line of a calibration file.
+ * @param file The file to write to.
+ * @param name The name of the values.
+ * @param values The values.
+ */
+template <typename T>
+void write_calibration_values(ofstream &file, const string &name, const vector<T> &values)
+{
+  file << name;
+  for (const T &value : values)
+  {
+    file << " " << value;
+  }
+  file << endl;
+}
+
+/**
+ * Save a calibration to a file.
+ * @param filename The name of the file.
+ * @param calibration The calibration to save.
+ */
+void save_calibration(const string &filename, const Calibration &calibration)
+{
+  ofstream file(filename);
+  if (!file.is_open())
+  {
+    cerr << "Unable to open file: " << filename << endl;
+    return;
+  }
+  file << setprecision(6);
+  file << "signature " << calibration.signature << endl;
+  file << "copy_gbps " << calibration.copy_gbps << endl;
+  file << "contention_ns " << calibration.contention_ns << endl;
+  write_calibration_values(file, "fanout_bits", calibration.fanout_bits);
+  write_calibration_values(file, "count_ns", calibration.count_ns);
+  write_calibration_values(file, "atomic_scatter_ns", calibration.atomic_scatter_ns);
+  write_calibration_values(file, "direct_scatter_ns", calibration.direct_scatter_ns);
+  write_calibration_values(file, "buffered_scatter_ns", calibration.buffered_scatter_ns);
+}
+
+/**
+ * Load a calibration from a file.
+ * @param filename The name of the file.
+ * @param calibration The calibration to load into.
+ * @return Whether a complete calibration could be loaded.
+ */
+bool load_calibration(const string &filename, Calibration &calibration)
+{
+  ifstream file(filename);
+  if (!file.is_open())
+  {
+    return false;
+  }
+
+  string line;
+  while (getline(file, line))
+  {
+    stringstream values(line);
+    string name;
+    values >> name;
+    if (name == "signature")
+    {
+      values >> calibration.signature;
+    }
+    else if (name == "copy_gbps")
+    {
+      values >> calibration.copy_gbps;
+    }
+    else if (name == "contention_ns")
+    {
+      values >> calibration.contention_ns;
+    }
+    else
+    {
+      vector<double> list;
+      double value;
+      while (values >> value)
+      {
+        list.push_back(value);
+      }
+      if (name == "fanout_bits")
+      {
+        calibration.fanout_bits.assign(list.begin(), list.end());
+      }
+      else if (name == "count_ns")
+      {
+        calibration.count_ns = list;
+      }
+      else if (name == "atomic_scatter_ns")
+      {
+        calibration.atomic_scatter_ns = list;
+      }
+      else if (name == "direct_scatter_ns")
+      {
+        calibration.direct_scatter_ns = list;
+      }
+      else if (name == "buffered_scatter_ns")
+      {
+        calibration.buffered_scatter_ns = list;
+      }
+    }
+  }
+
+  size_t points = calibration.fanout_bits.size();
+  return points > 0 && calibration.count_ns.size() == points && calibration.atomic_scatter_ns.size() == points &&
+         calibration.direct_scatter_ns.size() == points && calibration.buffered_scatter_ns.size() == points;
+}
+
+/**
+ * Interpolate a calibrated cost linearly in the number of fanout bits.
+ * @param calibration The calibration.
+ * @param costs The calibrated costs, one per calibrated fanout.
+ * @param bits The fanout to get the cost for as a number of bits.
+ * @return The cost per tuple in nanoseconds.
+ */
+double interpolate_cost(const Calibration &calibration, const vector<double> &costs, int bits)
+{
+  const vector<int> &points = calibration.fanout_bits;
+  if (bits <= points.front())
+  {
+    return costs.front();
+  }
+  for (size_t i = 1; i < points.size(); i++)
+  {
+    if (bits <= points[i])
+    {
+      double weight = double(bits - points[i - 1]) / (points[i] - points[i - 1]);
+      return costs[i - 1] + weight * (costs[i] - costs[i - 1]);
+    }
+  }
+  return costs.back();
+}
+
+/**
+ * Predict the running time of a plan. The compute time is the calibrated per-tuple cost of every pass spread over
+ * the cores, and it can never be faster than moving the bytes of every pass at the calibrated bandwidth.
+ * @param plan The plan to predict. Its predicted time is filled in.
+ * @param calibration The calibration.
+ * @param info The hardware info.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ */
+void predict(Plan &plan, const Calibration &calibration, const HardwareInfo &info, int num_of_threads,
+             int num_of_hashbits, int data_size)
+{
+  int effective_threads = max(1, min(num_of_threads, info.num_cores));
+  double tuple_bytes = sizeof(tuple<int64_t, int64_t>);
+  double compute_ns = 0;
+  double bytes = 0;
+
+  if (plan.algorithm == CONCURRENT_OUTPUT)
+  {
+    double fanout = 1 << num_of_hashbits;
+    double contention = calibration.contention_ns * min(1.0, (effective_threads - 1) / fanout);
+    compute_ns = interpolate_cost(calibration, calibration.atomic_scatter_ns, num_of_hashbits) + contention;
+    // Read once and write once
+    bytes = 2 * tuple_bytes;
+  }
+  else
+  {
+    for (int bits : split_hashbits(num_of_hashbits, plan.passes))
+    {
+      const vector<double> &scatter = plan.buffered ? calibration.buffered_scatter_ns : calibration.direct_scatter_ns;
+      compute_ns += interpolate_cost(calibration, calibration.count_ns, bits) +
+                    interpolate_cost(calibration, scatter, bits);
+      // Read twice and write once
+      bytes += 3 * tuple_bytes;
+    }
+  }
+
+  double compute_ms = compute_ns * data_size / effective_threads / 1e6;
+  double bandwidth_ms = bytes * data_size / calibration.copy_gbps / 1e6;
+  plan.predicted_ms = max(compute_ms, bandwidth_ms);
+}
+
+/**
+ * Get a readable name of a plan.
+ * @param plan The plan.
+ * @return The name of the plan.
+ */
+string get_plan_name(const Plan &plan)
+{
+  if (plan.algorithm == CONCURRENT_OUTPUT)
+  {
+    return "concurrent-output";
+  }
+  string name = plan.algorithm == TWO_PASS ? "two-pass" : "multi-pass(" + to_string(plan.passes) + ")";
+  return name + (plan.buffered ? " buffered" : " direct");
+}
+
+/**
+ * Predict every candidate plan and pick the cheapest.
+ * @param calibration The calibration.
+ * @param info The hardware info.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param debug The debug flag to print every candidate.
+ * @return The cheapest plan.
+ */
+Plan choose_plan(const Calibration &calibration, const HardwareInfo &info, int num_of_threads, int num_of_hashbits,
+                 int data_size, bool debug)
+{
+  vector<Plan> candidates;
+  candidates.push_back(Plan{CONCURRENT_OUTPUT, 1, false, 0});
+  for (int buffered = 0; buffered <= 1; buffered++)
+  {
+    candidates.push_back(Plan{TWO_PASS, 1, buffered == 1, 0});
+    for (int passes = 2; passes <= min(MAX_PASSES, num_of_hashbits); passes++)
+    {
+      candidates.push_back(Plan{MULTI_PASS, passes, buffered == 1, 0});
+    }
+  }
+
+  Plan best = candidates.front();
+  best.predicted_ms = 1e30;
+  for (Plan &plan : candidates)
+  {
+    predict(plan, calibration, info, num_of_threads, num_of_hashbits, data_size);
+    if (debug)
+    {
+      cout << "\tCandidate " << get_plan_name(plan) << ": " << plan.predicted_ms << " ms" << endl;
+    }
+    if (plan.predicted_ms < best.predicted_ms)
+    {
+      best = plan;
+    }
+  }
+  return best;
+}
+
+/**
+ * Check that every tuple ended up in its bucket and that no tuple was lost.
+ * @param result The partitioned data.
+ * @param num_of_buckets The number of buckets.
+ * @param data_size The size of the data.
+ * @return Whether the partitioning is correct.
+ */
+bool verify_output(const PartitionResult &result, int num_of_buckets, int data_size)
+{
+  long total = 0;
+  for (int i = 0; i < num_of_buckets; i++)
+  {
+    for (int j = 0; j < result.bucket_size[i]; j++)
+    {
+      if (get_partition(get<0>(result.output[result.bucket_start[i] + j]), num_of_buckets) != i)
+      {
+        return false;
+      }
+    }
+    total += result.bucket_size[i];
+  }
+  return total == data_size;
+}
+
+/**
+ * Print the output vector.
+ * @param result The partitioned data.
+ * @param num_of_buckets The number of buckets to use.
+ */
+void print_output(const PartitionResult &result, int num_of_buckets)
+{
+  cout << "Data (first 10 elements from each partition): " << endl;
+  for (int i = 0; i < min(num_of_buckets, 16); i++)
+  {
+    cout << "Partition " << i << " (size: " << result.bucket_size[i] << "): ";
+    for (int j = 0; j < min(10, result.bucket_size[i]); j++)
+    {
+      const tuple<int64_t, int64_t> &item = result.output[result.bucket_start[i] + j];
+      cout << "(" << get<0>(item) << "," << get<1>(item) << ") ";
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * Print the hardware info.
+ * @param info The hardware info.
+ */
+void print_hardware_info(const HardwareInfo &info)
+{
+  cout << "Hardware:" << endl;
+  cout << "\tCores: " << info.num_cores << endl;
+  cout << "\tCache line: " << info.cache_line_size << " B" << endl;
+  cout << "\tL1/L2/L3: " << (info.l1_size >> 10) << " KB / " << (info.l2_size >> 10) << " KB / "
+       << (info.l3_size >> 10) << " KB" << endl;
+  cout << "\tL1/L2 data TLB entries: " << info.l1_tlb_entries << " / " << info.l2_tlb_entries << endl;
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [calibration_file]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 calibration.txt" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << PROGRAM_NAME << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc != 6 && argc != 7)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  string calibration_file = argc == 7 ? argv[6] : "";
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug);
+
+  HardwareInfo info = read_hardware_info();
+  if (debug)
+  {
+    print_hardware_info(info);
+  }
+
+  // Reuse a saved calibration if it was made on this machine, otherwise calibrate and save it
+  Calibration calibration;
+  if (calibration_file.empty() || !load_calibration(calibration_file, calibration) ||
+      calibration.signature != get_hardware_signature(info))
+  {
+    cout << "Calibrating cost model..." << endl;
+    calibration = calibrate(info);
+    if (!calibration_file.empty())
+    {
+      save_calibration(calibration_file, calibration);
+    }
+  }
+  else
+  {
+    cout << "Loaded calibration from " << calibration_file << endl;
+  }
+
+  Plan plan = choose_plan(calibration, info, num_of_threads, num_of_hashbits, data_size, debug);
+  cout << "Chosen plan: " << get_plan_name(plan) << endl;
+
+  auto data = get_data_given_n(data_size);
+
+  auto start_time = high_resolution_clock::now();
+  PartitionResult result = run_plan(plan, data, num_of_threads, num_of_hashbits);
+  auto end_time = high_resolution_clock::now();
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+  double actual_ms = chrono::duration<double, milli>(end_time - start_time).count();
+
+  cout << fixed << setprecision(2);
+  cout << "Predicted time: " << plan.predicted_ms << " ms, actual time: " << actual_ms << " ms" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    cout << "Output verified: " << (verify_output(result, num_of_buckets, data_size) ? "yes" : "NO") << endl;
+    print_output(result, num_of_buckets);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
@@ -0,0 +1,612 @@
+/**
+ * This program builds a Bloom filter for every partition while the build side of a join is scattered, and uses the
+ * filters to drop probe tuples without a match before they are scattered.
+ * The filters are register-blocked: all bits of a key are in a single 64-bit word, so adding or testing a key touches
+ * one cache line. The count pass gives the size of every bucket, so every bucket gets a filter of about
+ * BLOOM_BITS_PER_KEY bits per tuple. The filter of a bucket is exposed together with its tuples by BloomBucketView.
+ * When the probe side is partitioned, both its count pass and its scatter pass skip keys the filter of their bucket
+ * rules out. The build and the probe side are also partitioned without filters for comparison.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used, for both the build and the probe side.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param match_percent (optional) The percentage of probe tuples with a matching build key, 0 to 100. Defaults to 10.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "bloom-partition";
+const string WITHOUT_BLOOM_PROGRAM_NAME = "partition-without-bloom";
+const string PROBE_PROGRAM_NAME = "bloom-probe-partition";
+const string PROBE_WITHOUT_BLOOM_PROGRAM_NAME = "probe-partition-without-bloom";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// Filter bits per build tuple, rounded up to a power of two words per bucket
+const int BLOOM_BITS_PER_KEY = 8;
+
+/**
+ * The Bloom filters of all buckets in one array of words. Bits are only ever set, with an atomic OR, since several
+ * threads scatter into the same bucket.
+ */
+struct BloomFilters
+{
+  vector<atomic<uint64_t>> words;
+  vector<int64_t> filter_start;
+  // Number of words of the filter of every bucket minus one, the sizes are powers of two
+  vector<uint64_t> filter_mask;
+};
+
+/**
+ * Mix the bits of a key. The keys of a bucket share their low bits, so they are hashed first.
+ * @param key The key to hash.
+ * @return The hash of the key.
+ */
+uint64_t hash_key(int64_t key)
+{
+  uint64_t h = key;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/**
+ * Get the four bits a hash sets in its word.
+ * @param h The hash of the key.
+ * @return The bits of the key.
+ */
+uint64_t bloom_bits(uint64_t h)
+{
+  return (1ULL << (h & 63)) | (1ULL << ((h >> 6) & 63)) | (1ULL << ((h >> 12) & 63)) | (1ULL << ((h >> 18) & 63));
+}
+
+/**
+ * Add a key to the filter of its bucket.
+ * @param filters The filters.
+ * @param bucket The bucket of the key.
+ * @param key The key to add.
+ */
+void bloom_add(BloomFilters &filters, int bucket, int64_t key)
+{
+  uint64_t h = hash_key(key);
+  atomic<uint64_t> &word = filters.words[filters.filter_start[bucket] + ((h >> 32) & filters.filter_mask[bucket])];
+  uint64_t bits = bloom_bits(h);
+  // Skip the atomic operation if the bits are set already
+  if ((word.load(memory_order_relaxed) & bits) != bits)
+  {
+    word.fetch_or(bits, memory_order_relaxed);
+  }
+}
+
+/**
+ * Test whether the filter of a bucket may contain a key.
+ * @param filters The filters.
+ * @param bucket The bucket of the key.
+ * @param key The key to test.
+ * @return False if the key is certainly not in the bucket.
+ */
+bool bloom_may_contain(const BloomFilters &filters, int bucket, int64_t key)
+{
+  uint64_t h = hash_key(key);
+  uint64_t word = filters.words[filters.filter_start[bucket] + ((h >> 32) & filters.filter_mask[bucket])].load(memory_order_relaxed);
+  uint64_t bits = bloom_bits(h);
+  return (word & bits) == bits;
+}
+
+/**
+ * A bucket of the partitioned build side together with its Bloom filter.
+ */
+class BloomBucketView
+{
+public:
+  BloomBucketView(const vector<tuple<int64_t, int64_t>> &output, const vector<int> &bucket_start,
+                  const BloomFilters &filters, int bucket)
+      : tuples_(output.data() + bucket_start[bucket]), size_(bucket_start[bucket + 1] - bucket_start[bucket]),
+        filters_(filters), bucket_(bucket) {}
+
+  int size() const
+  {
+    return size_;
+  }
+
+  const tuple<int64_t, int64_t> &operator[](int i) const
+  {
+    return tuples_[i];
+  }
+
+  bool may_contain(int64_t key) const
+  {
+    return bloom_may_contain(filters_, bucket_, key);
+  }
+
+private:
+  const tuple<int64_t, int64_t> *tuples_;
+  int size_;
+  const BloomFilters &filters_;
+  int bucket_;
+};
+
+/**
+ * Get the data given a number.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the probe side for a build side with the keys 1 to n. The other probe keys are larger than n.
+ * @param n The number of probe tuples.
+ * @param match_percent The percentage of probe tuples with a matching build key.
+ * @return The probe side.
+ */
+vector<tuple<int64_t, int64_t>> get_probe_data(int n, int match_percent)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    uint64_t h = hash_key(i);
+    bool match = h % 100 < (uint64_t)match_percent;
+    data[i] = tuple<int64_t, int64_t>(match ? (int64_t)((h >> 8) % n) + 1 : n + i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Count the number of tuples per bucket for a chunk, skipping the keys ruled out by the probe filters.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_buckets The number of buckets.
+ * @param probe_filters The filters keys have to pass, or nullptr to count every key.
+ * @param histogram The histogram of the thread.
+ */
+void count_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                 const BloomFilters *probe_filters, vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    int64_t key = get<0>(data[j]);
+    int partition = get_partition(key, num_of_buckets);
+    if (!probe_filters || bloom_may_contain(*probe_filters, partition, key))
+    {
+      histogram[partition]++;
+    }
+  }
+}
+
+/**
+ * Scatter a chunk, adding the keys to the build filters and skipping the keys ruled out by the probe filters.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param build_filters The filters to add the keys to, or nullptr to not build filters.
+ * @param probe_filters The filters keys have to pass, or nullptr to scatter every key.
+ * @param offsets The write offsets of the thread.
+ * @param output The output to scatter to.
+ */
+void scatter_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                   BloomFilters *build_filters, const BloomFilters *probe_filters, vector<int> &offsets,
+                   vector<tuple<int64_t, int64_t>> &output)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    int64_t key = get<0>(data[j]);
+    int partition = get_partition(key, num_of_buckets);
+    if (probe_filters && !bloom_may_contain(*probe_filters, partition, key))
+    {
+      continue;
+    }
+    output[offsets[partition]++] = data[j];
+    if (build_filters)
+    {
+      bloom_add(*build_filters, partition, key);
+    }
+  }
+}
+
+/**
+ * Size the filters of all buckets after the bucket sizes of the build side.
+ * @param filters The filters to size.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ * @param num_of_buckets The number of buckets.
+ */
+void size_filters(BloomFilters &filters, const vector<int> &bucket_start, int num_of_buckets)
+{
+  filters.filter_start.resize(num_of_buckets);
+  filters.filter_mask.resize(num_of_buckets);
+  int64_t total = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    int64_t needed = ((int64_t)(bucket_start[b + 1] - bucket_start[b]) * BLOOM_BITS_PER_KEY + 63) / 64;
+    int64_t words = 1;
+    while (words < needed)
+    {
+      words *= 2;
+    }
+    filters.filter_start[b] = total;
+    filters.filter_mask[b] = words - 1;
+    total += words;
+  }
+  vector<atomic<uint64_t>> words(total);
+  for (auto &word : words)
+  {
+    word.store(0, memory_order_relaxed);
+  }
+  filters.words.swap(words);
+}
+
+/**
+ * Partition the data with a count pass and a scatter pass.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads.
+ * @param num_of_buckets The number of buckets.
+ * @param build_filters The filters to size and build from the data, or nullptr to not build filters.
+ * @param probe_filters The filters keys have to pass, or nullptr to keep every key.
+ * @param output The partitioned data, sized to the kept tuples.
+ * @param bucket_start The first tuple of every bucket, followed by the output size.
+ */
+void run_partitioning(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads, int num_of_buckets,
+                      BloomFilters *build_filters, const BloomFilters *probe_filters,
+                      vector<tuple<int64_t, int64_t>> &output, vector<int> &bucket_start)
+{
+  int data_size = data.size();
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, i, start, end, cref(data), num_of_buckets, probe_filters,
+                             ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  int offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    bucket_start[b] = offset;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+  }
+  bucket_start[num_of_buckets] = offset;
+  output.resize(offset);
+  if (build_filters)
+  {
+    size_filters(*build_filters, bucket_start, num_of_buckets);
+  }
+
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk, i, start, end, cref(data), num_of_buckets, build_filters, probe_filters,
+                             ref(histograms[i]), ref(output)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+}
+
+/**
+ * Check that every build key passes the filter of its bucket and that no matching probe tuple was dropped.
+ * @param output The partitioned build side.
+ * @param bucket_start The first build tuple of every bucket, followed by the build size.
+ * @param filters The filters of the build side.
+ * @param probe_output The filtered and partitioned probe side.
+ * @param probe_start The first probe tuple of every bucket, followed by the number of kept probe tuples.
+ * @param probe The probe side.
+ * @param num_of_buckets The number of buckets.
+ * @return Whether the partitioning is correct.
+ */
+bool verify_output(const vector<tuple<int64_t, int64_t>> &output, const vector<int> &bucket_start,
+                   const BloomFilters &filters, const vector<tuple<int64_t, int64_t>> &probe_output,
+                   const vector<int> &probe_start, const vector<tuple<int64_t, int64_t>> &probe, int num_of_buckets)
+{
+  int64_t build_size = output.size();
+  long matching = 0;
+  for (const auto &item : probe)
+  {
+    matching += get<0>(item) <= build_size;
+  }
+  long kept_matching = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    BloomBucketView bucket(output, bucket_start, filters, b);
+    for (int j = 0; j < bucket.size(); j++)
+    {
+      if (get_partition(get<0>(bucket[j]), num_of_buckets) != b || !bucket.may_contain(get<0>(bucket[j])))
+      {
+        return false;
+      }
+    }
+    for (int j = probe_start[b]; j < probe_start[b + 1]; j++)
+    {
+      if (get_partition(get<0>(probe_output[j]), num_of_buckets) != b)
+      {
+        return false;
+      }
+      kept_matching += get<0>(probe_output[j]) <= build_size;
+    }
+  }
+  return kept_matching == matching;
+}
+
+/**
+ * Print the output vector.
+ * @param output The partitioned build side.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ * @param filters The filters of the build side.
+ * @param num_of_buckets The number of buckets to use.
+ */
+void print_output(const vector<tuple<int64_t, int64_t>> &output, const vector<int> &bucket_start,
+                  const BloomFilters &filters, int num_of_buckets)
+{
+  cout << "Data (first 10 elements from each partition): " << endl;
+  for (int b = 0; b < min(num_of_buckets, 16); b++)
+  {
+    BloomBucketView bucket(output, bucket_start, filters, b);
+    cout << "Partition " << b << " (size: " << bucket.size() << ", filter words: " << filters.filter_mask[b] + 1 << "): ";
+    for (int j = 0; j < min(10, bucket.size()); j++)
+    {
+      cout << "(" << get<0>(bucket[j]) << "," << get<1>(bucket[j]) << ") ";
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [match_percent]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 10" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param match_percent The percentage of probe tuples with a matching build key.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  int match_percent)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tMatching probe tuples: " << match_percent << "%" << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc != 6 && argc != 7)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  int match_percent = argc == 7 ? stoi(argv[6]) : 10;
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+  if (match_percent < 0 || match_percent > 100)
+  {
+    cerr << "Error: The percentage of matching probe tuples must be between 0 and 100" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, match_percent);
+
+  auto data = get_data_given_n(data_size);
+  auto probe = get_probe_data(data_size, match_percent);
+
+  // Build side without filters
+  vector<tuple<int64_t, int64_t>> plain_output;
+  vector<int> plain_start(num_of_buckets + 1);
+  auto plain_start_time = high_resolution_clock::now();
+  run_partitioning(data, num_of_threads, num_of_buckets, nullptr, nullptr, plain_output, plain_start);
+  auto plain_end_time = high_resolution_clock::now();
+  auto plain_duration = duration_cast<milliseconds>(plain_end_time - plain_start_time);
+
+  // Build side with filters
+  BloomFilters filters;
+  vector<tuple<int64_t, int64_t>> output;
+  vector<int> bucket_start(num_of_buckets + 1);
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+
+  run_partitioning(data, num_of_threads, num_of_buckets, &filters, nullptr, output, bucket_start);
+
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  // Probe side without and with the filters
+  vector<tuple<int64_t, int64_t>> probe_plain_output;
+  vector<int> probe_plain_start(num_of_buckets + 1);
+  auto probe_plain_start_time = high_resolution_clock::now();
+  run_partitioning(probe, num_of_threads, num_of_buckets, nullptr, nullptr, probe_plain_output, probe_plain_start);
+  auto probe_plain_end_time = high_resolution_clock::now();
+  auto probe_plain_duration = duration_cast<milliseconds>(probe_plain_end_time - probe_plain_start_time);
+
+  vector<tuple<int64_t, int64_t>> probe_output;
+  vector<int> probe_start(num_of_buckets + 1);
+  auto probe_start_time = high_resolution_clock::now();
+  run_partitioning(probe, num_of_threads, num_of_buckets, nullptr, &filters, probe_output, probe_start);
+  auto probe_end_time = high_resolution_clock::now();
+  auto probe_duration = duration_cast<milliseconds>(probe_end_time - probe_start_time);
+
+  long matching = 0;
+  for (const auto &item : probe)
+  {
+    matching += get<0>(item) <= data_size;
+  }
+  long false_positives = probe_output.size() - matching;
+  long non_matching = data_size - matching;
+
+  cout << fixed << setprecision(2);
+  cout << "Build without filters: " << chrono::duration<double, milli>(plain_end_time - plain_start_time).count() << " ms" << endl;
+  cout << "Build with filters: " << chrono::duration<double, milli>(end_time - start_time).count() << " ms ("
+       << filters.words.size() * 8 / 1e6 << " MB of filters)" << endl;
+  cout << "Probe without filters: " << chrono::duration<double, milli>(probe_plain_end_time - probe_plain_start_time).count() << " ms" << endl;
+  cout << "Probe with filters: " << chrono::duration<double, milli>(probe_end_time - probe_start_time).count() << " ms ("
+       << 100.0 * (data_size - probe_output.size()) / max(1, data_size) << "% of the probe tuples dropped)" << endl;
+  cout << "False positive rate: " << 100.0 * false_positives / max(1L, non_matching) << "%" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    bool verified = verify_output(output, bucket_start, filters, probe_output, probe_start, probe, num_of_buckets);
+    cout << "Output verified: " << (verified ? "yes" : "NO") << endl;
+    print_output(output, bucket_start, filters, num_of_buckets);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  // The build side is recorded per match percentage too, since the Makefile runs it once for every one
+  append_metrics_to_csv(filename, PROGRAM_NAME + "-" + to_string(match_percent), num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+  append_metrics_to_csv(filename, WITHOUT_BLOOM_PROGRAM_NAME + "-" + to_string(match_percent), num_of_threads, num_of_hashbits, num_of_buckets, data_size, plain_duration.count(), thread::hardware_concurrency(), memory_used);
+  append_metrics_to_csv(filename, PROBE_PROGRAM_NAME + "-" + to_string(match_percent), num_of_threads, num_of_hashbits, num_of_buckets, data_size, probe_duration.count(), thread::hardware_concurrency(), memory_used);
+  append_metrics_to_csv(filename, PROBE_WITHOUT_BLOOM_PROGRAM_NAME + "-" + to_string(match_percent), num_of_threads, num_of_hashbits, num_of_buckets, data_size, probe_plain_duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
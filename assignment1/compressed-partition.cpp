@@ -0,0 +1,540 @@
+/**
+ * This program partitions the data into a compressed output format.
+ * After partitioning on the low num_of_hashbits bits of the key, those bits are the same for every tuple in a bucket,
+ * so they are dropped from the output and only the remaining key bits are stored, bit-packed with the smallest width
+ * that fits the largest key. Optionally the payload is bit-packed the same way. The tuples are decoded transparently
+ * through a bucket view.
+ * The partitioning itself is a two-pass count-then-scatter with a histogram per thread, so the output position of
+ * every tuple is known up front.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param pack_payload (optional) 1 to bit-pack the payload as well, 0 to store it as a full 64-bit value. Defaults to 0.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "compressed-partition";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+/**
+ * The partitioned data in the compressed format. Every tuple takes key_bits + payload_bits bits and the tuples of
+ * bucket i are stored one after the other starting at tuple index bucket_start[i], so tuple j of the output starts at
+ * bit j * (key_bits + payload_bits) of words.
+ */
+struct CompressedPartitions
+{
+  vector<uint64_t> words;
+  vector<int64_t> bucket_start;
+  vector<int> bucket_size;
+  int num_of_hashbits;
+  int key_bits;
+  int payload_bits;
+};
+
+/**
+ * Read a bit-packed value.
+ * @param words The words the value is packed into.
+ * @param bit_pos The position of the first bit of the value.
+ * @param width The width of the value in bits, between 1 and 64.
+ * @return The value.
+ */
+uint64_t read_bits(const uint64_t *words, int64_t bit_pos, int width)
+{
+  int64_t word = bit_pos >> 6;
+  int offset = bit_pos & 63;
+  uint64_t value = words[word] >> offset;
+  if (offset + width > 64)
+  {
+    value |= words[word + 1] << (64 - offset);
+  }
+  return width == 64 ? value : value & ((uint64_t(1) << width) - 1);
+}
+
+/**
+ * A read-only view of a single compressed bucket that decodes its tuples on access.
+ */
+class CompressedBucketView
+{
+public:
+  /**
+   * Create a view of a bucket.
+   * @param partitions The compressed partitions.
+   * @param bucket The bucket to view.
+   */
+  CompressedBucketView(const CompressedPartitions &partitions, int bucket) : partitions(partitions), bucket(bucket)
+  {
+  }
+
+  /**
+   * Get the number of tuples in the bucket.
+   * @return The number of tuples.
+   */
+  int size() const
+  {
+    return partitions.bucket_size[bucket];
+  }
+
+  /**
+   * Decode a tuple of the bucket. The dropped radix bits of the key are restored from the bucket number.
+   * @param i The index of the tuple within the bucket.
+   * @return The decoded tuple.
+   */
+  tuple<int64_t, int64_t> operator[](int i) const
+  {
+    int tuple_bits = partitions.key_bits + partitions.payload_bits;
+    int64_t bit_pos = (partitions.bucket_start[bucket] + i) * tuple_bits;
+    uint64_t key = partitions.key_bits == 0 ? 0 : read_bits(partitions.words.data(), bit_pos, partitions.key_bits);
+    uint64_t payload = partitions.payload_bits == 0
+                           ? 0
+                           : read_bits(partitions.words.data(), bit_pos + partitions.key_bits, partitions.payload_bits);
+    return tuple<int64_t, int64_t>((int64_t)(key << partitions.num_of_hashbits | bucket), (int64_t)payload);
+  }
+
+private:
+  const CompressedPartitions &partitions;
+  int bucket;
+};
+
+/**
+ * The write state of a thread for one bucket. Bits are collected in word until it is complete, so every output
+ * word is written once. Only the first and the last word of the region of a thread can be shared with the region of
+ * another thread, and only those are written with an atomic OR.
+ */
+struct BitWriter
+{
+  uint64_t word;
+  int64_t bit_pos;
+  int64_t first_word;
+};
+
+/**
+ * Get the data given a number.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Get the number of bits needed to store a value.
+ * @param value The value, or the OR of all values to store.
+ * @return The number of bits needed.
+ */
+int get_bit_width(uint64_t value)
+{
+  return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Count the tuples of a chunk per bucket and collect the bits used by the keys and payloads.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_hashbits The number of hash bits.
+ * @param histogram The histogram of the thread.
+ * @param key_bits_used The OR of all keys of the chunk without their radix bits.
+ * @param payload_bits_used The OR of all payloads of the chunk.
+ */
+void count_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_hashbits,
+                 vector<int64_t> &histogram, uint64_t &key_bits_used, uint64_t &payload_bits_used)
+{
+  pin_thread(thread_id);
+  int num_of_buckets = 1 << num_of_hashbits;
+  uint64_t keys = 0;
+  uint64_t payloads = 0;
+  for (int j = start; j < end; j++)
+  {
+    histogram[get_partition(get<0>(data[j]), num_of_buckets)]++;
+    keys |= (uint64_t)get<0>(data[j]) >> num_of_hashbits;
+    payloads |= (uint64_t)get<1>(data[j]);
+  }
+  key_bits_used = keys;
+  payload_bits_used = payloads;
+}
+
+/**
+ * Write a completed word of a bucket region.
+ * @param words The output words.
+ * @param writer The write state of the bucket.
+ * @param word The index of the word to write.
+ */
+void store_word(uint64_t *words, const BitWriter &writer, int64_t word)
+{
+  if (word == writer.first_word)
+  {
+    __atomic_fetch_or(&words[word], writer.word, __ATOMIC_RELAXED);
+  }
+  else
+  {
+    words[word] = writer.word;
+  }
+}
+
+/**
+ * Append a value to the region of a bucket.
+ * @param words The output words.
+ * @param writer The write state of the bucket.
+ * @param value The value to append.
+ * @param width The width of the value in bits, between 1 and 64.
+ */
+void write_bits(uint64_t *words, BitWriter &writer, uint64_t value, int width)
+{
+  int offset = writer.bit_pos & 63;
+  writer.word |= value << offset;
+  if (offset + width >= 64)
+  {
+    store_word(words, writer, writer.bit_pos >> 6);
+    writer.word = offset == 0 ? 0 : value >> (64 - offset);
+  }
+  writer.bit_pos += width;
+}
+
+/**
+ * Scatter a chunk of data into the compressed output.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param partitions The compressed partitions to write to.
+ * @param offsets The output tuple index of the region of this thread in every bucket.
+ */
+void scatter_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data,
+                   CompressedPartitions &partitions, const vector<int64_t> &offsets)
+{
+  pin_thread(thread_id);
+  int num_of_hashbits = partitions.num_of_hashbits;
+  int num_of_buckets = 1 << num_of_hashbits;
+  int key_bits = partitions.key_bits;
+  int payload_bits = partitions.payload_bits;
+  int tuple_bits = key_bits + payload_bits;
+  uint64_t *words = partitions.words.data();
+
+  vector<BitWriter> writers(num_of_buckets);
+  for (int i = 0; i < num_of_buckets; i++)
+  {
+    writers[i].word = 0;
+    writers[i].bit_pos = offsets[i] * tuple_bits;
+    writers[i].first_word = writers[i].bit_pos >> 6;
+  }
+
+  for (int j = start; j < end; j++)
+  {
+    BitWriter &writer = writers[get_partition(get<0>(data[j]), num_of_buckets)];
+    if (key_bits > 0)
+    {
+      write_bits(words, writer, (uint64_t)get<0>(data[j]) >> num_of_hashbits, key_bits);
+    }
+    if (payload_bits > 0)
+    {
+      write_bits(words, writer, (uint64_t)get<1>(data[j]), payload_bits);
+    }
+  }
+
+  // The last word of every region is partial and may be shared with the next region
+  for (int i = 0; i < num_of_buckets; i++)
+  {
+    if (writers[i].bit_pos & 63)
+    {
+      __atomic_fetch_or(&words[writers[i].bit_pos >> 6], writers[i].word, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+/**
+ * Check that every decoded tuple is in its bucket and matches the generated data, and that no tuple was lost.
+ * @param partitions The compressed partitions.
+ * @param data_size The size of the data.
+ * @return Whether the partitioning is correct.
+ */
+bool verify_output(const CompressedPartitions &partitions, int data_size)
+{
+  int num_of_buckets = 1 << partitions.num_of_hashbits;
+  long total = 0;
+  for (int i = 0; i < num_of_buckets; i++)
+  {
+    CompressedBucketView bucket(partitions, i);
+    for (int j = 0; j < bucket.size(); j++)
+    {
+      tuple<int64_t, int64_t> item = bucket[j];
+      if (get_partition(get<0>(item), num_of_buckets) != i || get<0>(item) != get<1>(item) || get<0>(item) < 1 ||
+          get<0>(item) > data_size)
+      {
+        return false;
+      }
+    }
+    total += bucket.size();
+  }
+  return total == data_size;
+}
+
+/**
+ * Print the output vector.
+ * @param partitions The compressed partitions.
+ */
+void print_output(const CompressedPartitions &partitions)
+{
+  int num_of_buckets = 1 << partitions.num_of_hashbits;
+  cout << "Data (first 10 elements from each partition): " << endl;
+  for (int i = 0; i < min(num_of_buckets, 16); i++)
+  {
+    CompressedBucketView bucket(partitions, i);
+    cout << "Partition " << i << " (size: " << bucket.size() << "): ";
+    for (int j = 0; j < min(10, bucket.size()); j++)
+    {
+      tuple<int64_t, int64_t> item = bucket[j];
+      cout << "(" << get<0>(item) << "," << get<1>(item) << ") ";
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [pack_payload]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 1" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param pack_payload Whether the payload is bit-packed.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  bool pack_payload)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tPack payload: " << pack_payload << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << PROGRAM_NAME << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc != 6 && argc != 7)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  bool pack_payload = argc == 7 && stoi(argv[6]);
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, pack_payload);
+
+  auto data = get_data_given_n(data_size);
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+
+  vector<thread> threads;
+  vector<vector<int64_t>> histograms(num_of_threads, vector<int64_t>(num_of_buckets, 0));
+  vector<uint64_t> key_bits_used(num_of_threads, 0);
+  vector<uint64_t> payload_bits_used(num_of_threads, 0);
+  CompressedPartitions partitions;
+  partitions.num_of_hashbits = num_of_hashbits;
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+
+  // First pass: count the tuples per bucket and find the bit widths
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, i, start, end, ref(data), num_of_hashbits, ref(histograms[i]),
+                             ref(key_bits_used[i]), ref(payload_bits_used[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  uint64_t keys = 0;
+  uint64_t payloads = 0;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    keys |= key_bits_used[i];
+    payloads |= payload_bits_used[i];
+  }
+  partitions.key_bits = get_bit_width(keys);
+  partitions.payload_bits = pack_payload ? get_bit_width(payloads) : 64;
+  int tuple_bits = partitions.key_bits + partitions.payload_bits;
+
+  // Turn the histograms into the output tuple index of every (thread, bucket) region
+  int64_t offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    partitions.bucket_start.push_back(offset);
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int64_t count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+    partitions.bucket_size.push_back(offset - partitions.bucket_start[b]);
+  }
+  // One extra word so that reading a value never runs past the end
+  partitions.words.assign((offset * tuple_bits + 63) / 64 + 1, 0);
+
+  // Second pass: scatter the compressed tuples
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk, i, start, end, ref(data), ref(partitions), cref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  long compressed_bytes = partitions.words.size() * sizeof(uint64_t);
+  long uncompressed_bytes = (long)data_size * sizeof(tuple<int64_t, int64_t>);
+  cout << "Bits per tuple: " << tuple_bits << " (key " << partitions.key_bits << ", payload " << partitions.payload_bits
+       << ")" << endl;
+  cout << fixed << setprecision(2);
+  cout << "Output size: " << compressed_bytes / 1e6 << " MB compressed vs " << uncompressed_bytes / 1e6
+       << " MB uncompressed (" << (double)uncompressed_bytes / compressed_bytes << "x)" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    cout << "Processing time: " << duration.count() << " ms with " << num_of_threads << " threads" << endl;
+    cout << "Output verified: " << (verify_output(partitions, data_size) ? "yes" : "NO") << endl;
+    print_output(partitions);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
@@ -8,6 +8,17 @@
  * @param data_size The size of the data to use.
  * @param filename The name of the CSV file to append metrics to.
  * @param debug The debug flag to print debug information.
+ * @param prefetch_distance (optional) The number of elements whose destinations are prefetched ahead of the writes.
+ *        0 (the default) disables prefetching.
+ * @param compute_intensity (optional) The number of do_computation rounds fused into the scatter loop per tuple.
+ *        0 (the default) disables the transform.
+ * @param transform_mode (optional) Where the transform runs: "before" (the default) or "after" the partition of a
+ *        tuple is computed, or "batch" to run it on groups of tuples before their partitions are computed.
+ * @param trace_file (optional) The file to write a Chrome trace JSON of the thread start, the phases, every morsel
+ *        and the join to. No tracing without it or with "-".
+ * @param counter_layout (optional) The layout of the bucket counters: "packed" (the default), "padded" or "sharded".
+ * @param profile_interval (optional) Time one in this many counter increments per thread and report the cycles per
+ *        thread and per bucket. 0 (the default) disables profiling.
  * @return The exit status of the program. Will write to the CSV file.
  */
 
@@ -18,8 +29,13 @@
 #include <tuple>
 #include <atomic>
 #include <chrono>
+#include <algorithm>
 #include <iomanip>
+#include <sched.h>
 #include <sys/sysinfo.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 using namespace std;
 using namespace std::chrono;
@@ -29,16 +45,555 @@ const string PROGRAM_NAME = "count-then-move";
 // Define a maximum number of buckets for the atomic array
 const int MAX_BUCKETS = 1 << 18;
 
+// Largest supported prefetch distance, i.e. the largest group of elements moved together
+const int MAX_PREFETCH_DISTANCE = 64;
+
+// Number of tuples a batch transform works on without prefetching, as large as the largest prefetched group
+const int TRANSFORM_BATCH_SIZE = MAX_PREFETCH_DISTANCE;
+
+/**
+ * Where the user transform runs in the scatter loop.
+ */
+enum TransformMode
+{
+  // On every tuple before its partition is computed
+  TRANSFORM_BEFORE,
+  // On every tuple after its partition is computed, just before the write
+  TRANSFORM_AFTER,
+  // On groups of tuples before their partitions are computed
+  TRANSFORM_BATCH
+};
+
 // Add some computation to better demonstrate multi-core benefits
-void do_computation(tuple<int64_t, int64_t> &item)
+inline void do_computation(tuple<int64_t, int64_t> &item, int intensity)
 {
   // Simple but non-trivial computation
-  for (int i = 0; i < 50; i++)
+  for (int i = 0; i < intensity; i++)
   {
     get<1>(item) = (get<0>(item) * get<1>(item) + i) % 10000;
   }
 }
 
+/**
+ * The transform used without computation. IDENTITY lets the scatter loop skip the transform entirely, so the plain
+ * loop is the same as without the hook.
+ */
+struct NoTransform
+{
+  static const bool IDENTITY = true;
+
+  void operator()(tuple<int64_t, int64_t> &) const {}
+
+  void batch(tuple<int64_t, int64_t> *, int) const {}
+};
+
+/**
+ * The transform running do_computation with a number of rounds per tuple.
+ * The batch variant runs every round over the whole group, so the tuples of the inner loop are independent. The 64-bit
+ * modulo keeps the compiler from vectorizing it on x86, so it changes the order of the work, not its instructions.
+ */
+struct ComputeTransform
+{
+  static const bool IDENTITY = false;
+
+  int intensity;
+
+  void operator()(tuple<int64_t, int64_t> &item) const
+  {
+    do_computation(item, intensity);
+  }
+
+  void batch(tuple<int64_t, int64_t> *items, int group_size) const
+  {
+    for (int i = 0; i < intensity; i++)
+    {
+      for (int j = 0; j < group_size; j++)
+      {
+        get<1>(items[j]) = (get<0>(items[j]) * get<1>(items[j]) + i) % 10000;
+      }
+    }
+  }
+};
+
+// Number of spans every thread keeps; a thread that records more overwrites its oldest spans
+const int TRACE_EVENTS_PER_THREAD = 1 << 14;
+
+// Number of tuples traced as one morsel
+const int TRACE_MORSEL_SIZE = 1 << 16;
+
+/**
+ * Read the time stamp counter, or a nanosecond clock where there is none.
+ * The counter is assumed to be invariant and synchronized between cores, as on current x86 CPUs.
+ * @return The current time in ticks.
+ */
+inline uint64_t read_tsc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * A traced span of time on one thread, in ticks.
+ */
+struct TraceEvent
+{
+  const char *name;
+  const char *arg_name;
+  uint64_t start;
+  uint64_t end;
+  int64_t arg;
+};
+
+/**
+ * The ring buffer of one thread, padded so that the counters of two threads are never on the same cache line.
+ */
+struct ThreadTrace
+{
+  vector<TraceEvent> events;
+  uint64_t count;
+  char padding[128 - sizeof(vector<TraceEvent>) - sizeof(uint64_t)];
+};
+
+/**
+ * Records spans of time per thread and writes them as Chrome trace JSON, which chrome://tracing and Perfetto open.
+ * Every thread only writes to its own ring buffer, so recording needs no synchronization. While tracing is disabled
+ * a span costs one well-predicted branch.
+ */
+class Tracer
+{
+public:
+  Tracer() : enabled(false), start_tsc(0) {}
+
+  /**
+   * Enable tracing.
+   * @param num_of_threads The number of threads that record spans. The last one is the main thread.
+   */
+  void enable(int num_of_threads)
+  {
+    threads.resize(num_of_threads);
+    for (auto &trace : threads)
+    {
+      trace.events.resize(TRACE_EVENTS_PER_THREAD);
+      trace.count = 0;
+    }
+    start_time = steady_clock::now();
+    start_tsc = read_tsc();
+    enabled = true;
+  }
+
+  bool is_enabled() const
+  {
+    return enabled;
+  }
+
+  void record(int thread_id, const char *name, const char *arg_name, uint64_t start, uint64_t end, int64_t arg)
+  {
+    ThreadTrace &trace = threads[thread_id];
+    TraceEvent &event = trace.events[trace.count++ & (TRACE_EVENTS_PER_THREAD - 1)];
+    event.name = name;
+    event.arg_name = arg_name;
+    event.start = start;
+    event.end = end;
+    event.arg = arg;
+  }
+
+  /**
+   * Write the recorded spans as Chrome trace JSON. Must only be called after all threads have been joined.
+   * @param filename The name of the JSON file.
+   * @return Whether the file could be written.
+   */
+  bool dump(const string &filename) const
+  {
+    ofstream file(filename);
+    if (!file.is_open())
+    {
+      return false;
+    }
+    // Convert ticks to microseconds with the clock rate seen since tracing was enabled
+    double elapsed_us = duration<double, micro>(steady_clock::now() - start_time).count();
+    double ticks_per_us = max(1e-9, (read_tsc() - start_tsc) / max(1.0, elapsed_us));
+
+    file << fixed << setprecision(3);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" << endl;
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+      string thread_name = t + 1 == threads.size() ? "main" : "worker " + to_string(t);
+      file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t << ",\"args\":{\"name\":\""
+           << thread_name << "\"}}";
+      const ThreadTrace &trace = threads[t];
+      uint64_t first = trace.count > (uint64_t)TRACE_EVENTS_PER_THREAD ? trace.count - TRACE_EVENTS_PER_THREAD : 0;
+      for (uint64_t i = first; i < trace.count; i++)
+      {
+        const TraceEvent &event = trace.events[i & (TRACE_EVENTS_PER_THREAD - 1)];
+        file << "," << endl
+             << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << t
+             << ",\"ts\":" << (event.start - start_tsc) / ticks_per_us
+             << ",\"dur\":" << (event.end - event.start) / ticks_per_us;
+        if (event.arg_name != nullptr)
+        {
+          file << ",\"args\":{\"" << event.arg_name << "\":" << event.arg << "}";
+        }
+        file << "}";
+      }
+      file << (t + 1 == threads.size() ? "" : ",") << endl;
+    }
+    file << "]}" << endl;
+    return true;
+  }
+
+private:
+  bool enabled;
+  vector<ThreadTrace> threads;
+  steady_clock::time_point start_time;
+  uint64_t start_tsc;
+};
+
+// The tracer of the program, enabled when a trace file is given
+Tracer tracer;
+
+/**
+ * Traces the lifetime of the scope as a span of the calling thread.
+ */
+class TraceScope
+{
+public:
+  TraceScope(int thread_id, const char *name, const char *arg_name = nullptr, int64_t arg = 0)
+      : thread_id(thread_id), name(name), arg_name(arg_name), arg(arg), start(tracer.is_enabled() ? read_tsc() : 0) {}
+
+  ~TraceScope()
+  {
+    if (tracer.is_enabled())
+    {
+      tracer.record(thread_id, name, arg_name, start, read_tsc(), arg);
+    }
+  }
+
+private:
+  int thread_id;
+  const char *name;
+  const char *arg_name;
+  int64_t arg;
+  uint64_t start;
+};
+
+// Number of ints in a cache line, the distance between two padded counters
+const int INTS_PER_CACHE_LINE = 64 / sizeof(int);
+
+// Largest number of slots a thread leases from a sharded counter at once
+const int MAX_LEASE_SIZE = 64;
+
+// Sampled increments taking longer than this many cycles were interrupted or descheduled and are not counted
+const uint64_t MAX_SAMPLE_CYCLES = 1 << 16;
+
+/**
+ * How the bucket counters are laid out in memory.
+ */
+enum CounterLayout
+{
+  // One atomic int per bucket, sixteen to a cache line
+  PACKED_COUNTERS,
+  // One atomic int per cache line
+  PADDED_COUNTERS,
+  // Packed shared counters from which every thread leases runs of slots into private cursors
+  SHARDED_COUNTERS
+};
+
+/**
+ * The counters handing out the slots of the buckets, in one of the layouts.
+ * With the sharded layout only one in lease_size increments of a thread touches the shared counter. The unused
+ * slots of the last lease of every thread stay empty (key 0), so a bucket needs room for one lease per thread more
+ * than its tuples; the lease size is limited to keep that below a quarter of the bucket.
+ */
+class BucketCounters
+{
+public:
+  /**
+   * Create the counters, all at 0.
+   * @param layout The layout of the counters.
+   * @param num_of_buckets The number of buckets.
+   * @param num_of_threads The number of threads.
+   * @param bucket_capacity The number of tuples a bucket is expected to hold.
+   */
+  BucketCounters(CounterLayout layout, int num_of_buckets, int num_of_threads, int bucket_capacity)
+      : stride(layout == PADDED_COUNTERS ? INTS_PER_CACHE_LINE : 1), lease_size(0), base(0),
+        counters((size_t)num_of_buckets * stride + INTS_PER_CACHE_LINE)
+  {
+    for (auto &counter : counters)
+    {
+      counter.store(0, memory_order_relaxed);
+    }
+    // Start at a cache line boundary so that every padded counter has a line of its own
+    base = (64 - (uintptr_t)counters.data() % 64) % 64 / sizeof(atomic<int>);
+    if (layout == SHARDED_COUNTERS)
+    {
+      lease_size = max(1, min(MAX_LEASE_SIZE, bucket_capacity / (4 * num_of_threads)));
+      cursors.assign(num_of_threads, vector<int>(2 * num_of_buckets, 0));
+    }
+  }
+
+  /**
+   * Hand out the next slot of a bucket.
+   * @param bucket The bucket.
+   * @param thread_id The id of the calling thread.
+   * @return The slot.
+   */
+  int increment(int bucket, int thread_id)
+  {
+    if (lease_size == 0)
+    {
+      return counters[base + bucket * stride]++;
+    }
+    // The cursor of a bucket is the next leased slot followed by the end of the lease
+    int *cursor = &cursors[thread_id][2 * bucket];
+    if (cursor[0] == cursor[1])
+    {
+      cursor[0] = counters[base + bucket * stride].fetch_add(lease_size);
+      cursor[1] = cursor[0] + lease_size;
+    }
+    return cursor[0]++;
+  }
+
+  /**
+   * Get the slot the next increment of a thread will probably return, for prefetching.
+   * @param bucket The bucket.
+   * @param thread_id The id of the calling thread.
+   * @return The slot.
+   */
+  int peek(int bucket, int thread_id) const
+  {
+    if (lease_size > 0 && cursors[thread_id][2 * bucket] != cursors[thread_id][2 * bucket + 1])
+    {
+      return cursors[thread_id][2 * bucket];
+    }
+    return counters[base + bucket * stride].load(memory_order_relaxed);
+  }
+
+  /**
+   * Prefetch what the next increment of a thread touches.
+   * @param bucket The bucket.
+   * @param thread_id The id of the calling thread.
+   */
+  void prefetch(int bucket, int thread_id) const
+  {
+    if (lease_size > 0)
+    {
+      __builtin_prefetch(&cursors[thread_id][2 * bucket], 1);
+      return;
+    }
+    __builtin_prefetch(&counters[base + bucket * stride], 1);
+  }
+
+  /**
+   * Get the number of slots handed out for a bucket, including the empty ones. Only valid once all threads are done.
+   * @param bucket The bucket.
+   * @return The number of slots.
+   */
+  int slots(int bucket) const
+  {
+    return counters[base + bucket * stride].load();
+  }
+
+  /**
+   * Get the number of tuples in a bucket. Only valid once all threads are done.
+   * @param bucket The bucket.
+   * @return The number of tuples.
+   */
+  int size(int bucket) const
+  {
+    int unused = 0;
+    for (const auto &cursor : cursors)
+    {
+      unused += cursor[2 * bucket + 1] - cursor[2 * bucket];
+    }
+    return slots(bucket) - unused;
+  }
+
+  /**
+   * Get the number of slots a bucket needs beyond its tuples.
+   * @return The number of slots.
+   */
+  int slack() const
+  {
+    return lease_size * (int)cursors.size();
+  }
+
+  int get_lease_size() const
+  {
+    return lease_size;
+  }
+
+private:
+  int stride;
+  int lease_size;
+  size_t base;
+  vector<atomic<int>> counters;
+  vector<vector<int>> cursors;
+};
+
+/**
+ * The sampled cost of the counter increments of one thread. The padding keeps the fields written on every increment
+ * of two threads off the same cache line.
+ */
+struct ThreadContention
+{
+  int countdown;
+  uint64_t random;
+  uint64_t samples;
+  uint64_t cycles;
+  uint64_t outliers;
+  vector<uint64_t> bucket_cycles;
+  vector<uint32_t> bucket_samples;
+  char padding[64];
+};
+
+/**
+ * Times about one in every sample interval increments of the bucket counters of every thread with the time stamp
+ * counter, and sums the cycles per thread and per bucket. The gaps between samples are random, so the samples do not
+ * line up with a regular pattern in the keys. The cost of reading the counter is subtracted from every sample.
+ * While profiling is disabled an increment costs one well-predicted branch more.
+ */
+class ContentionProfiler
+{
+public:
+  ContentionProfiler() : enabled(false), interval(0), overhead(0) {}
+
+  /**
+   * Enable profiling.
+   * @param num_of_threads The number of threads.
+   * @param num_of_buckets The number of buckets.
+   * @param sample_interval The number of increments per sample.
+   */
+  void enable(int num_of_threads, int num_of_buckets, int sample_interval)
+  {
+    threads.resize(num_of_threads);
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+      ThreadContention &contention = threads[t];
+      contention.countdown = sample_interval;
+      contention.random = (t + 1) * 0x9E3779B97F4A7C15ULL;
+      contention.samples = 0;
+      contention.cycles = 0;
+      contention.outliers = 0;
+      contention.bucket_cycles.assign(num_of_buckets, 0);
+      contention.bucket_samples.assign(num_of_buckets, 0);
+    }
+    interval = sample_interval;
+    // The cheapest of many back-to-back reads is the cost of reading the counter itself
+    overhead = UINT64_MAX;
+    for (int i = 0; i < 1000; i++)
+    {
+      uint64_t first = read_tsc();
+      overhead = min(overhead, read_tsc() - first);
+    }
+    enabled = true;
+  }
+
+  bool is_enabled() const
+  {
+    return enabled;
+  }
+
+  bool should_sample(int thread_id)
+  {
+    if (!enabled)
+    {
+      return false;
+    }
+    ThreadContention &contention = threads[thread_id];
+    if (--contention.countdown > 0)
+    {
+      return false;
+    }
+    // The next gap is uniform between 1 and twice the interval (xorshift)
+    contention.random ^= contention.random << 13;
+    contention.random ^= contention.random >> 7;
+    contention.random ^= contention.random << 17;
+    contention.countdown = 1 + contention.random % (2 * interval);
+    return true;
+  }
+
+  void record(int thread_id, int bucket, uint64_t cycles)
+  {
+    ThreadContention &contention = threads[thread_id];
+    if (cycles > MAX_SAMPLE_CYCLES)
+    {
+      contention.outliers++;
+      return;
+    }
+    cycles = cycles > overhead ? cycles - overhead : 0;
+    contention.samples++;
+    contention.cycles += cycles;
+    contention.bucket_samples[bucket]++;
+    contention.bucket_cycles[bucket] += cycles;
+  }
+
+  /**
+   * Print the mean cycles per increment of every thread and of the hottest buckets.
+   * @param num_of_buckets The number of buckets.
+   */
+  void print(int num_of_buckets) const
+  {
+    uint64_t samples = 0;
+    uint64_t cycles = 0;
+    uint64_t outliers = 0;
+    vector<uint64_t> bucket_samples(num_of_buckets, 0);
+    vector<uint64_t> bucket_cycles(num_of_buckets, 0);
+    for (const auto &contention : threads)
+    {
+      samples += contention.samples;
+      cycles += contention.cycles;
+      outliers += contention.outliers;
+      for (int b = 0; b < num_of_buckets; b++)
+      {
+        bucket_samples[b] += contention.bucket_samples[b];
+        bucket_cycles[b] += contention.bucket_cycles[b];
+      }
+    }
+
+    cout << fixed << setprecision(1);
+    cout << "Counter contention (cycles per increment, about 1 in " << interval << " sampled, " << overhead
+         << " cycles of overhead subtracted):" << endl;
+    cout << "\tAll threads: " << (double)cycles / max<uint64_t>(1, samples) << " over " << samples << " samples ("
+         << outliers << " interrupted samples dropped)" << endl;
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+      cout << "\tThread " << t << ": " << (double)threads[t].cycles / max<uint64_t>(1, threads[t].samples) << endl;
+    }
+
+    vector<int> buckets;
+    for (int b = 0; b < num_of_buckets; b++)
+    {
+      if (bucket_samples[b] > 0)
+      {
+        buckets.push_back(b);
+      }
+    }
+    sort(buckets.begin(), buckets.end(), [&](int a, int b) {
+      return (double)bucket_cycles[a] / bucket_samples[a] > (double)bucket_cycles[b] / bucket_samples[b];
+    });
+    cout << "\tHottest buckets:";
+    for (size_t i = 0; i < min<size_t>(8, buckets.size()); i++)
+    {
+      int b = buckets[i];
+      cout << " " << b << " (" << (double)bucket_cycles[b] / bucket_samples[b] << ")";
+    }
+    cout << endl;
+    cout.unsetf(ios_base::floatfield);
+  }
+
+private:
+  bool enabled;
+  int interval;
+  uint64_t overhead;
+  vector<ThreadContention> threads;
+};
+
+// The contention profiler of the program, enabled with a sample interval
+ContentionProfiler profiler;
+
 /**
  * Get the data given a number.
  * @param n The number to get the data for.
@@ -67,12 +622,21 @@ int get_partition(int64_t n, int num_of_buckets)
 
 /**
  * Atomically increment the counter for a bucket and return the previous value.
+ * When profiling, one in every sample interval increments of a thread is timed.
  * @param counter The counter to increment.
  * @param id The id of the counter to increment.
+ * @param thread_id The id of the calling thread.
  */
-int increment_buffer_counter(array<atomic<int>, MAX_BUCKETS> &counter, int id)
+int increment_buffer_counter(BucketCounters &counter, int id, int thread_id)
 {
-  return counter[id]++;
+  if (profiler.should_sample(thread_id))
+  {
+    uint64_t start = read_tsc();
+    int pos = counter.increment(id, thread_id);
+    profiler.record(thread_id, id, read_tsc() - start);
+    return pos;
+  }
+  return counter.increment(id, thread_id);
 }
 
 /**
@@ -89,21 +653,129 @@ int compute_input_chunk_size(int data_size, int num_of_threads)
 /**
  * Move an element to its destination buffer.
  * @param counter The counter to increment.
+ * @param thread_id The id of the thread.
  * @param item The item to move.
  * @param buffers The buffers to move the item to.
  * @param num_of_buckets The number of buckets to use.
  */
-void move_element(array<atomic<int>, MAX_BUCKETS> &counter, const tuple<int64_t, int64_t> &item,
+void move_element(BucketCounters &counter, int thread_id, const tuple<int64_t, int64_t> &item,
                   vector<vector<tuple<int64_t, int64_t>>> &buffers, int num_of_buckets)
 {
   int partition = get_partition(get<0>(item), num_of_buckets);
-  int pos = increment_buffer_counter(counter, partition);
+  int pos = increment_buffer_counter(counter, partition, thread_id);
   buffers[partition][pos] = item;
 }
 
+/**
+ * Move a group of elements to their partitions with software prefetching.
+ * The partitions of the whole group are computed first and their counters and buffer headers are prefetched, then
+ * the destination slot of every element is prefetched, and only then are the elements written. This way the cache
+ * misses of the group overlap instead of the loop stalling on one miss at a time.
+ * @param counter The counter to increment.
+ * @param thread_id The id of the thread.
+ * @param items The group of elements to move.
+ * @param group_size The number of elements in the group, at most MAX_PREFETCH_DISTANCE.
+ * @param buffers The buffers to move the data to.
+ * @param num_of_buckets The number of buckets to use.
+ */
+void move_group_with_prefetch(BucketCounters &counter, int thread_id, const tuple<int64_t, int64_t> *items,
+                              int group_size, vector<vector<tuple<int64_t, int64_t>>> &buffers, int num_of_buckets)
+{
+  int partitions[MAX_PREFETCH_DISTANCE];
+  for (int i = 0; i < group_size; i++)
+  {
+    partitions[i] = get_partition(get<0>(items[i]), num_of_buckets);
+    counter.prefetch(partitions[i], thread_id);
+    __builtin_prefetch(&buffers[partitions[i]], 0);
+  }
+
+  // The counter may still move before the write, in which case the prefetch was only a hint for a nearby slot
+  for (int i = 0; i < group_size; i++)
+  {
+    int pos = counter.peek(partitions[i], thread_id);
+    __builtin_prefetch(buffers[partitions[i]].data() + pos, 1);
+  }
+
+  for (int i = 0; i < group_size; i++)
+  {
+    buffers[partitions[i]][increment_buffer_counter(counter, partitions[i], thread_id)] = items[i];
+  }
+}
+
+/**
+ * Move a range of the data to the partitions.
+ * @param counter The counter to increment.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the range.
+ * @param end The end index of the range.
+ * @param data The data to process.
+ * @param buffers The buffers to move the data to.
+ * @param num_of_buckets The number of buckets to use.
+ * @param prefetch_distance The number of elements moved as one prefetched group, 0 to move them one by one.
+ * @param transform The transform fused into the loop, inlined since it is a template parameter.
+ * @param mode Where the transform runs. With prefetching it always runs on the prefetched groups.
+ */
+template <typename Transform>
+void move_range(BucketCounters &counter, int thread_id, int start, int end,
+                const vector<tuple<int64_t, int64_t>> &data,
+                vector<vector<tuple<int64_t, int64_t>>> &buffers,
+                int num_of_buckets, int prefetch_distance, Transform transform, TransformMode mode)
+{
+  if (prefetch_distance > 0 && Transform::IDENTITY)
+  {
+    for (int j = start; j < end; j += prefetch_distance)
+    {
+      move_group_with_prefetch(counter, thread_id, &data[j], min(prefetch_distance, end - j), buffers, num_of_buckets);
+    }
+    return;
+  }
+
+  if (prefetch_distance > 0 || mode == TRANSFORM_BATCH)
+  {
+    int group_size = prefetch_distance > 0 ? prefetch_distance : TRANSFORM_BATCH_SIZE;
+    tuple<int64_t, int64_t> group[MAX_PREFETCH_DISTANCE];
+    for (int j = start; j < end; j += group_size)
+    {
+      int size = min(group_size, end - j);
+      copy(&data[j], &data[j] + size, group);
+      transform.batch(group, size);
+      if (prefetch_distance > 0)
+      {
+        move_group_with_prefetch(counter, thread_id, group, size, buffers, num_of_buckets);
+        continue;
+      }
+      for (int i = 0; i < size; i++)
+      {
+        move_element(counter, thread_id, group[i], buffers, num_of_buckets);
+      }
+    }
+    return;
+  }
+
+  if (mode == TRANSFORM_AFTER)
+  {
+    for (int j = start; j < end; j++)
+    {
+      auto item = data[j];
+      int partition = get_partition(get<0>(item), num_of_buckets);
+      transform(item);
+      buffers[partition][increment_buffer_counter(counter, partition, thread_id)] = item;
+    }
+    return;
+  }
+
+  for (int j = start; j < end; j++)
+  {
+    auto item = data[j];
+    transform(item);
+    move_element(counter, thread_id, item, buffers, num_of_buckets);
+  }
+}
+
 /**
  * Process a chunk of data with affinity to a specific CPU core.
  * This function handles both computation and data movement in a single pass.
+ * The chunk is moved one morsel at a time so that every morsel shows up in the trace.
  * @param counter The counter to increment.
  * @param thread_id The id of the thread.
  * @param start The start index of the chunk.
@@ -111,12 +783,17 @@ void move_element(array<atomic<int>, MAX_BUCKETS> &counter, const tuple<int64_t,
  * @param data The data to process.
  * @param buffers The buffers to move the data to.
  * @param num_of_buckets The number of buckets to use.
+ * @param prefetch_distance The number of elements moved as one prefetched group, 0 to move them one by one.
+ * @param transform The transform fused into the loop, inlined since it is a template parameter.
+ * @param mode Where the transform runs. With prefetching it always runs on the prefetched groups.
  */
-void process_chunk(array<atomic<int>, MAX_BUCKETS> &counter, int thread_id, int start, int end,
+template <typename Transform>
+void process_chunk(BucketCounters &counter, int thread_id, int start, int end,
                    const vector<tuple<int64_t, int64_t>> &data,
                    vector<vector<tuple<int64_t, int64_t>>> &buffers,
-                   int num_of_buckets)
+                   int num_of_buckets, int prefetch_distance, Transform transform, TransformMode mode)
 {
+  uint64_t thread_start = read_tsc();
   // Set thread affinity to specific CPU core
   cpu_set_t cpuset;
   CPU_ZERO(&cpuset);
@@ -124,31 +801,41 @@ void process_chunk(array<atomic<int>, MAX_BUCKETS> &counter, int thread_id, int
   CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
   pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
 
-  for (int j = start; j < end; j++)
+  if (tracer.is_enabled())
   {
-    auto item = data[j];
-    // do_computation(item); // Do some actual computation
-    move_element(counter, item, buffers, num_of_buckets);
+    tracer.record(thread_id, "thread start", "cpu", thread_start, read_tsc(), sched_getcpu());
+  }
+
+  TraceScope phase(thread_id, "move");
+  for (int morsel_start = start; morsel_start < end; morsel_start += TRACE_MORSEL_SIZE)
+  {
+    TraceScope morsel(thread_id, "morsel", "morsel", morsel_start / TRACE_MORSEL_SIZE);
+    move_range(counter, thread_id, morsel_start, min(morsel_start + TRACE_MORSEL_SIZE, end), data, buffers, num_of_buckets,
+               prefetch_distance, transform, mode);
   }
 }
 
 /**
- * Print the output vector.
+ * Print the output vector. Slots left empty by the sharded counters (key 0) are skipped.
  * @param output The output vector to print.
  * @param num_of_buckets The number of buckets to use.
  * @param counter The counter to use.
  */
 void print_output(const vector<vector<tuple<int64_t, int64_t>>> &buffers, int num_of_buckets,
-                  const array<atomic<int>, MAX_BUCKETS> &counter)
+                  const BucketCounters &counter)
 {
   cout << "Data (first 10 elements from each partition): " << endl;
   for (int i = 0; i < num_of_buckets; i++)
   {
-    cout << "Partition " << i << " (size: " << counter[i] << "): ";
-    int elements_to_print = min(10, counter[i].load());
-    for (int j = 0; j < elements_to_print; j++)
+    cout << "Partition " << i << " (size: " << counter.size(i) << "): ";
+    int printed = 0;
+    for (int j = 0; j < counter.slots(i) && printed < 10; j++)
     {
-      cout << "(" << get<0>(buffers[i][j]) << "," << get<1>(buffers[i][j]) << ") ";
+      if (get<0>(buffers[i][j]) != 0)
+      {
+        cout << "(" << get<0>(buffers[i][j]) << "," << get<1>(buffers[i][j]) << ") ";
+        printed++;
+      }
     }
     cout << endl;
   }
@@ -157,6 +844,7 @@ void print_output(const vector<vector<tuple<int64_t, int64_t>>> &buffers, int nu
 /**
  * Append performance metrics to a CSV file.
  * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record the metrics under.
  * @param num_of_threads The number of threads used.
  * @param num_of_hashbits The number of hash bits used.
  * @param num_of_buckets The number of buckets used.
@@ -165,14 +853,14 @@ void print_output(const vector<vector<tuple<int64_t, int64_t>>> &buffers, int nu
  * @param num_cores The number of CPU cores used.
  * @param memory_used The amount of memory used.
  */
-void append_metrics_to_csv(const string &filename, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
 {
   ofstream file;
   // open file on linux
   file.open(filename, ios_base::app);
   if (file.is_open())
   {
-    file << PROGRAM_NAME << ","
+    file << algorithm << ","
          << num_of_threads << ","
          << num_of_hashbits << ","
          << num_of_buckets << ","
@@ -194,7 +882,7 @@ void append_metrics_to_csv(const string &filename, int num_of_threads, int num_o
  */
 void print_usage(const char *program_name)
 {
-  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug>" << endl;
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [prefetch_distance] [compute_intensity] [transform_mode] [trace_file] [counter_layout] [profile_interval]" << endl;
   cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0" << endl;
 }
 
@@ -207,8 +895,13 @@ void print_usage(const char *program_name)
  * @param data_size The size of the data used.
  * @param filename The name of the CSV file.
  * @param debug The debug flag.
+ * @param compute_intensity The number of do_computation rounds per tuple.
+ * @param transform_mode The name of the transform mode.
+ * @param counter_layout The name of the counter layout.
+ * @param profile_interval The number of counter increments per sample, 0 without profiling.
  */
-void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug)
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  int compute_intensity, const string &transform_mode, const string &counter_layout, int profile_interval)
 {
   cout << "Running " << program_name << " with the following parameters:" << endl;
   cout << "\tNumber of threads: " << num_of_threads << endl;
@@ -217,6 +910,10 @@ void print_params(const char *program_name, int num_of_threads, int num_of_hashb
   cout << "\tData size: " << data_size << endl;
   cout << "\tOutput file: " << filename << endl;
   cout << "\tDebug flag: " << debug << endl;
+  cout << "\tCompute intensity: " << compute_intensity << endl;
+  cout << "\tTransform mode: " << transform_mode << endl;
+  cout << "\tCounter layout: " << counter_layout << endl;
+  cout << "\tProfile interval: " << profile_interval << endl;
 }
 
 /**
@@ -225,7 +922,7 @@ void print_params(const char *program_name, int num_of_threads, int num_of_hashb
  */
 int main(int argc, char *argv[])
 {
-  if (argc != 6)
+  if (argc < 6 || argc > 12)
   {
     print_usage(argv[0]);
     return 1;
@@ -236,6 +933,12 @@ int main(int argc, char *argv[])
   int data_size = stoi(argv[3]);
   string filename = argv[4];
   bool debug = stoi(argv[5]);
+  int prefetch_distance = argc >= 7 ? stoi(argv[6]) : 0;
+  int compute_intensity = argc >= 8 ? stoi(argv[7]) : 0;
+  string transform_mode_name = argc >= 9 ? argv[8] : "before";
+  string trace_file = argc >= 10 && string(argv[9]) != "-" ? argv[9] : "";
+  string counter_layout_name = argc >= 11 ? argv[10] : "packed";
+  int profile_interval = argc >= 12 ? stoi(argv[11]) : 0;
 
   int num_of_buckets = 1 << num_of_hashbits;
   if (num_of_buckets > MAX_BUCKETS)
@@ -243,40 +946,119 @@ int main(int argc, char *argv[])
     cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
     return 1;
   }
+  if (prefetch_distance < 0 || prefetch_distance > MAX_PREFETCH_DISTANCE)
+  {
+    cerr << "Error: Prefetch distance must be between 0 and " << MAX_PREFETCH_DISTANCE << endl;
+    return 1;
+  }
+  TransformMode transform_mode;
+  if (transform_mode_name == "before")
+  {
+    transform_mode = TRANSFORM_BEFORE;
+  }
+  else if (transform_mode_name == "after")
+  {
+    transform_mode = TRANSFORM_AFTER;
+  }
+  else if (transform_mode_name == "batch")
+  {
+    transform_mode = TRANSFORM_BATCH;
+  }
+  else
+  {
+    cerr << "Error: Transform mode must be before, after or batch" << endl;
+    return 1;
+  }
+  if (compute_intensity < 0)
+  {
+    cerr << "Error: Compute intensity must not be negative" << endl;
+    return 1;
+  }
+  CounterLayout counter_layout;
+  if (counter_layout_name == "packed")
+  {
+    counter_layout = PACKED_COUNTERS;
+  }
+  else if (counter_layout_name == "padded")
+  {
+    counter_layout = PADDED_COUNTERS;
+  }
+  else if (counter_layout_name == "sharded")
+  {
+    counter_layout = SHARDED_COUNTERS;
+  }
+  else
+  {
+    cerr << "Error: Counter layout must be packed, padded or sharded" << endl;
+    return 1;
+  }
+  if (profile_interval < 0)
+  {
+    cerr << "Error: Profile interval must not be negative" << endl;
+    return 1;
+  }
 
-  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug);
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, compute_intensity, transform_mode_name,
+               counter_layout_name, profile_interval);
 
-  // Use atomic counters for thread-safe operations with fixed maximum size
-  array<atomic<int>, MAX_BUCKETS> counter;
+  // Use atomic counters for thread-safe operations, laid out as requested
+  int bucket_capacity = data_size / num_of_buckets + 1;
+  BucketCounters counter(counter_layout, num_of_buckets, num_of_threads, bucket_capacity);
+  if (profile_interval > 0)
+  {
+    profiler.enable(num_of_threads, num_of_buckets, profile_interval);
+  }
 
-  // Initialize atomic counters
-  for (int i = 0; i < MAX_BUCKETS; i++)
+  // The main thread records its spans after the workers
+  int main_trace_id = num_of_threads;
+  if (!trace_file.empty())
   {
-    counter[i] = 0;
+    tracer.enable(num_of_threads + 1);
   }
 
+  uint64_t generate_start = read_tsc();
   auto data = get_data_given_n(data_size);
+  if (tracer.is_enabled())
+  {
+    tracer.record(main_trace_id, "generate data", nullptr, generate_start, read_tsc(), 0);
+  }
   int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
 
   vector<thread> threads;
   // Create output buffers for each partition
-  vector<vector<tuple<int64_t, int64_t>>> buffers(num_of_buckets, vector<tuple<int64_t, int64_t>>(data_size / num_of_buckets + 1));
+  vector<vector<tuple<int64_t, int64_t>>> buffers(num_of_buckets, vector<tuple<int64_t, int64_t>>(bucket_capacity + counter.slack()));
 
   auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
 
   // Launch threads to process data chunks concurrently
+  uint64_t launch_start = read_tsc();
   for (int i = 0; i < num_of_threads; i++)
   {
     int start = i * chunk_size;
     int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
-    threads.push_back(thread(process_chunk, ref(counter), i, start, end, ref(data), ref(buffers), num_of_buckets));
+    if (compute_intensity > 0)
+    {
+      ComputeTransform transform = {compute_intensity};
+      threads.push_back(thread(process_chunk<ComputeTransform>, ref(counter), i, start, end, ref(data), ref(buffers), num_of_buckets, prefetch_distance, transform, transform_mode));
+    }
+    else
+    {
+      threads.push_back(thread(process_chunk<NoTransform>, ref(counter), i, start, end, ref(data), ref(buffers), num_of_buckets, prefetch_distance, NoTransform(), transform_mode));
+    }
   }
 
+  uint64_t join_start = read_tsc();
+
   // Wait for all threads to complete
   for (auto &t : threads)
   {
     t.join();
   }
+  if (tracer.is_enabled())
+  {
+    tracer.record(main_trace_id, "launch threads", "threads", launch_start, join_start, num_of_threads);
+    tracer.record(main_trace_id, "join", nullptr, join_start, read_tsc(), 0);
+  }
 
   auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
   auto duration = duration_cast<milliseconds>(end_time - start_time);
@@ -289,12 +1071,49 @@ int main(int argc, char *argv[])
     print_output(buffers, num_of_buckets, counter);
   }
 
+  if (counter_layout == SHARDED_COUNTERS)
+  {
+    cout << "Lease size: " << counter.get_lease_size() << " slots" << endl;
+  }
+  if (profiler.is_enabled())
+  {
+    profiler.print(num_of_buckets);
+  }
+
   struct sysinfo memInfo;
   sysinfo(&memInfo);
   long memory_used = memInfo.totalram - memInfo.freeram;
 
   // Append metrics to CSV file using the provided filename
-  append_metrics_to_csv(filename, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+  // Prefetching runs are recorded as their own algorithm so the sweep can compare them per hash bit
+  string algorithm = prefetch_distance > 0 ? PROGRAM_NAME + "-prefetch-" + to_string(prefetch_distance) : PROGRAM_NAME;
+  // Runs with a fused transform are recorded per intensity and mode to find the compute/memory crossover
+  if (compute_intensity > 0)
+  {
+    algorithm += "-compute-" + to_string(compute_intensity) + "-" + (prefetch_distance > 0 ? "batch" : transform_mode_name);
+  }
+  // Other counter layouts and profiled runs are recorded on their own as well
+  if (counter_layout != PACKED_COUNTERS)
+  {
+    algorithm += "-" + counter_layout_name + "-counters";
+  }
+  if (profiler.is_enabled())
+  {
+    algorithm += "-profiled";
+  }
+  append_metrics_to_csv(filename, algorithm, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+
+  if (tracer.is_enabled())
+  {
+    if (tracer.dump(trace_file))
+    {
+      cout << "Trace written to " << trace_file << endl;
+    }
+    else
+    {
+      cerr << "Unable to open file: " << trace_file << endl;
+    }
+  }
 
   return 0;
 }
@@ -0,0 +1,654 @@
+/**
+ * This program writes the partitioned data to a file that other processes can map bucket by bucket.
+ * The file starts with a header and a bucket index holding the offset and the tuple count of every bucket, followed by
+ * the buckets, each stored contiguously. The data is partitioned with a count pass and a scatter pass straight into a
+ * shared mapping of the file, so nothing is copied through a buffer. A reader maps the header once and then maps only
+ * the pages of the buckets it needs, without parsing or copying.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param path (optional) The partition file to write and read. Defaults to partitions.bin.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "file-partition-write";
+const string SCAN_PROGRAM_NAME = "file-partition-scan";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// Identifies a partition file and its version
+const char FILE_MAGIC[8] = {'P', 'A', 'R', 'T', 'F', 'I', 'L', 'E'};
+const uint32_t FILE_VERSION = 1;
+
+// The bucket data starts at this alignment in the file. Mappings are aligned to the page size of the machine instead,
+// which may be larger.
+const uint64_t FILE_ALIGNMENT = 4096;
+
+/**
+ * A tuple as stored in the file, with a fixed layout independent of std::tuple.
+ */
+struct FileTuple
+{
+  int64_t key;
+  int64_t payload;
+};
+
+/**
+ * The header at the start of the file, followed by num_of_buckets BucketIndexEntry.
+ */
+struct FileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t num_of_buckets;
+  uint64_t tuple_size;
+  uint64_t data_size;
+};
+
+/**
+ * Where a bucket is in the file.
+ */
+struct BucketIndexEntry
+{
+  // Byte offset of the first tuple from the start of the file
+  uint64_t offset;
+  uint64_t count;
+};
+
+/**
+ * A bucket of a partition file mapped into memory. Unmaps the bucket when destroyed.
+ */
+class MappedBucket
+{
+public:
+  MappedBucket(void *mapping, size_t mapping_size, const FileTuple *tuples, uint64_t count)
+      : mapping_(mapping), mapping_size_(mapping_size), tuples_(tuples), count_(count), failed_(false) {}
+
+  MappedBucket(MappedBucket &&other)
+      : mapping_(other.mapping_), mapping_size_(other.mapping_size_), tuples_(other.tuples_), count_(other.count_),
+        failed_(other.failed_)
+  {
+    other.mapping_ = nullptr;
+  }
+
+  /**
+   * A bucket that could not be mapped. It has no tuples.
+   * @return The failed bucket.
+   */
+  static MappedBucket failure()
+  {
+    MappedBucket bucket(nullptr, 0, nullptr, 0);
+    bucket.failed_ = true;
+    return bucket;
+  }
+
+  MappedBucket(const MappedBucket &) = delete;
+  MappedBucket &operator=(const MappedBucket &) = delete;
+
+  ~MappedBucket()
+  {
+    if (mapping_)
+    {
+      munmap(mapping_, mapping_size_);
+    }
+  }
+
+  uint64_t size() const
+  {
+    return count_;
+  }
+
+  bool failed() const
+  {
+    return failed_;
+  }
+
+  const FileTuple &operator[](uint64_t i) const
+  {
+    return tuples_[i];
+  }
+
+private:
+  void *mapping_;
+  size_t mapping_size_;
+  const FileTuple *tuples_;
+  uint64_t count_;
+  bool failed_;
+};
+
+/**
+ * Reads a partition file. Only the header and the bucket index are mapped when the file is opened.
+ */
+class PartitionFile
+{
+public:
+  PartitionFile() : fd_(-1), header_(nullptr), header_size_(0), file_size_(0), page_size_(sysconf(_SC_PAGESIZE)) {}
+
+  PartitionFile(const PartitionFile &) = delete;
+  PartitionFile &operator=(const PartitionFile &) = delete;
+
+  ~PartitionFile()
+  {
+    if (header_)
+    {
+      munmap((void *)header_, header_size_);
+    }
+    if (fd_ >= 0)
+    {
+      close(fd_);
+    }
+  }
+
+  /**
+   * Open a partition file and check its header.
+   * @param path The path of the file.
+   * @return Whether the file is a valid partition file.
+   */
+  bool open(const string &path)
+  {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    struct stat file_stat;
+    if (fd_ < 0 || fstat(fd_, &file_stat) != 0 || (uint64_t)file_stat.st_size < sizeof(FileHeader))
+    {
+      return false;
+    }
+    FileHeader header;
+    if (pread(fd_, &header, sizeof(header), 0) != sizeof(header) ||
+        memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != FILE_VERSION ||
+        header.tuple_size != sizeof(FileTuple))
+    {
+      return false;
+    }
+    header_size_ = sizeof(FileHeader) + header.num_of_buckets * sizeof(BucketIndexEntry);
+    if ((uint64_t)file_stat.st_size < header_size_)
+    {
+      return false;
+    }
+    void *mapping = mmap(nullptr, header_size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED)
+    {
+      return false;
+    }
+    header_ = (const FileHeader *)mapping;
+    file_size_ = file_stat.st_size;
+    return true;
+  }
+
+  int num_of_buckets() const
+  {
+    return header_->num_of_buckets;
+  }
+
+  uint64_t data_size() const
+  {
+    return header_->data_size;
+  }
+
+  const BucketIndexEntry &index(int bucket) const
+  {
+    return ((const BucketIndexEntry *)(header_ + 1))[bucket];
+  }
+
+  /**
+   * Map the pages of a single bucket.
+   * @param bucket The bucket to map.
+   * @return The mapped bucket, failed if the bucket lies outside the file or could not be mapped.
+   */
+  MappedBucket map_bucket(int bucket) const
+  {
+    const BucketIndexEntry &entry = index(bucket);
+    uint64_t bytes = entry.count * sizeof(FileTuple);
+    if (entry.count == 0)
+    {
+      return MappedBucket(nullptr, 0, nullptr, 0);
+    }
+    if (entry.offset + bytes > file_size_)
+    {
+      return MappedBucket::failure();
+    }
+    uint64_t page_offset = entry.offset / page_size_ * page_size_;
+    size_t mapping_size = entry.offset - page_offset + bytes;
+    void *mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd_, page_offset);
+    if (mapping == MAP_FAILED)
+    {
+      return MappedBucket::failure();
+    }
+    return MappedBucket(mapping, mapping_size, (const FileTuple *)((char *)mapping + (entry.offset - page_offset)),
+                        entry.count);
+  }
+
+private:
+  int fd_;
+  const FileHeader *header_;
+  size_t header_size_;
+  uint64_t file_size_;
+  uint64_t page_size_;
+};
+
+/**
+ * Get the data given a number.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Count the number of tuples per bucket for a chunk.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_buckets The number of buckets.
+ * @param histogram The histogram of the thread.
+ */
+void count_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                 vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    histogram[get_partition(get<0>(data[j]), num_of_buckets)]++;
+  }
+}
+
+/**
+ * Scatter a chunk into the mapped file.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param offsets The write offsets of the thread, in tuples from the start of the bucket data.
+ * @param output The bucket data in the mapped file.
+ */
+void scatter_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                   vector<int> &offsets, FileTuple *output)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    FileTuple &slot = output[offsets[get_partition(get<0>(data[j]), num_of_buckets)]++];
+    slot.key = get<0>(data[j]);
+    slot.payload = get<1>(data[j]);
+  }
+}
+
+/**
+ * Partition the data into a new partition file.
+ * @param path The path of the file.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads.
+ * @param num_of_buckets The number of buckets.
+ * @return Whether the file was written.
+ */
+bool write_partition_file(const string &path, const vector<tuple<int64_t, int64_t>> &data, int num_of_threads,
+                          int num_of_buckets)
+{
+  int data_size = data.size();
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, i, start, end, cref(data), num_of_buckets, ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  uint64_t index_size = sizeof(FileHeader) + num_of_buckets * sizeof(BucketIndexEntry);
+  uint64_t data_start = (index_size + FILE_ALIGNMENT - 1) / FILE_ALIGNMENT * FILE_ALIGNMENT;
+  uint64_t file_size = data_start + (uint64_t)data_size * sizeof(FileTuple);
+
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate(fd, file_size) != 0)
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    return false;
+  }
+  char *mapping = (char *)mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    return false;
+  }
+
+  FileHeader *header = (FileHeader *)mapping;
+  memcpy(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+  header->version = FILE_VERSION;
+  header->num_of_buckets = num_of_buckets;
+  header->tuple_size = sizeof(FileTuple);
+  header->data_size = data_size;
+  BucketIndexEntry *index = (BucketIndexEntry *)(header + 1);
+
+  int offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    index[b].offset = data_start + (uint64_t)offset * sizeof(FileTuple);
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+    index[b].count = offset - (index[b].offset - data_start) / sizeof(FileTuple);
+  }
+
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk, i, start, end, cref(data), num_of_buckets, ref(histograms[i]),
+                             (FileTuple *)(mapping + data_start)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  return munmap(mapping, file_size) == 0;
+}
+
+/**
+ * Map and scan whole buckets of a partition file. Buckets are handed out to the threads dynamically.
+ * @param thread_id The id of the thread.
+ * @param next_bucket The next bucket to scan, shared by all threads.
+ * @param file The partition file.
+ * @param checksum The sum of the payloads scanned by the thread.
+ * @param misplaced The number of tuples found in the wrong bucket by the thread.
+ * @param unmapped The number of buckets the thread could not map.
+ */
+void scan_buckets(int thread_id, atomic<int> &next_bucket, const PartitionFile &file, int64_t &checksum,
+                  long &misplaced, long &unmapped)
+{
+  pin_thread(thread_id);
+  for (int b = next_bucket++; b < file.num_of_buckets(); b = next_bucket++)
+  {
+    MappedBucket bucket = file.map_bucket(b);
+    unmapped += bucket.failed();
+    for (uint64_t j = 0; j < bucket.size(); j++)
+    {
+      checksum += bucket[j].payload;
+      misplaced += get_partition(bucket[j].key, file.num_of_buckets()) != b;
+    }
+  }
+}
+
+/**
+ * Print the output vector.
+ * @param file The partition file.
+ */
+void print_output(const PartitionFile &file)
+{
+  cout << "Data (first 10 elements from each partition): " << endl;
+  for (int b = 0; b < min(file.num_of_buckets(), 16); b++)
+  {
+    MappedBucket bucket = file.map_bucket(b);
+    cout << "Partition " << b << " (size: " << file.index(b).count << ", offset: " << file.index(b).offset << "): ";
+    if (bucket.failed())
+    {
+      cout << "not mapped";
+    }
+    for (uint64_t j = 0; j < min<uint64_t>(10, bucket.size()); j++)
+    {
+      cout << "(" << bucket[j].key << "," << bucket[j].payload << ") ";
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [path]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 partitions.bin" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param path The partition file.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  const string &path)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tPartition file: " << path << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc != 6 && argc != 7)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  string path = argc == 7 ? argv[6] : "partitions.bin";
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, path);
+
+  auto data = get_data_given_n(data_size);
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+
+  if (!write_partition_file(path, data, num_of_threads, num_of_buckets))
+  {
+    cerr << "Error: Unable to write partition file: " << path << endl;
+    return 1;
+  }
+
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  // Open the file again and scan every bucket through its own mapping
+  auto scan_start_time = high_resolution_clock::now();
+  PartitionFile file;
+  if (!file.open(path))
+  {
+    cerr << "Error: Not a valid partition file: " << path << endl;
+    return 1;
+  }
+  auto open_end_time = high_resolution_clock::now();
+
+  atomic<int> next_bucket(0);
+  vector<int64_t> checksums(num_of_threads, 0);
+  vector<long> misplaced(num_of_threads, 0);
+  vector<long> unmapped(num_of_threads, 0);
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    threads.push_back(thread(scan_buckets, i, ref(next_bucket), cref(file), ref(checksums[i]), ref(misplaced[i]),
+                             ref(unmapped[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+  long total_unmapped = 0;
+  for (long u : unmapped)
+  {
+    total_unmapped += u;
+  }
+  if (total_unmapped > 0)
+  {
+    cerr << "Error: Unable to map " << total_unmapped << " buckets of the partition file: " << path << endl;
+    return 1;
+  }
+  auto scan_end_time = high_resolution_clock::now();
+  auto scan_duration = duration_cast<milliseconds>(scan_end_time - scan_start_time);
+
+  double write_ms = chrono::duration<double, milli>(end_time - start_time).count();
+  double scan_ms = chrono::duration<double, milli>(scan_end_time - scan_start_time).count();
+  double file_mb = ((double)data_size * sizeof(FileTuple)) / 1e6;
+  cout << fixed << setprecision(2);
+  cout << "Write: " << write_ms << " ms (" << file_mb / write_ms * 1000 << " MB/s)" << endl;
+  cout << "Open: " << chrono::duration<double, milli>(open_end_time - scan_start_time).count() << " ms" << endl;
+  cout << "Open and scan: " << scan_ms << " ms (" << file_mb / scan_ms * 1000 << " MB/s)" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    int64_t checksum = 0;
+    long total_misplaced = 0;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      checksum += checksums[i];
+      total_misplaced += misplaced[i];
+    }
+    bool verified = total_misplaced == 0 && file.data_size() == (uint64_t)data_size &&
+                    checksum == (int64_t)data_size * (data_size + 1) / 2;
+    cout << "Output verified: " << (verified ? "yes" : "NO") << endl;
+    print_output(file);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+  append_metrics_to_csv(filename, SCAN_PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, scan_duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
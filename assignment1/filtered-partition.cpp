@@ -0,0 +1,496 @@
+/**
+ * This program pushes a filter and a projection down into the partitioner.
+ * The predicate and the projection are functors passed as template parameters, so they are inlined into the count and
+ * the scatter loop. The count pass counts only the tuples that pass the predicate and the scatter pass writes only
+ * their projections, so filtered tuples are never written. For comparison the same data is first partitioned
+ * completely and then filtered and projected bucket by bucket, which is what we did before.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param selectivity (optional) The percentage of tuples that pass the predicate, 1 to 100. Defaults to 10.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "filter-pushdown";
+const string FILTER_AFTER_PROGRAM_NAME = "filter-after";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+/**
+ * Keeps a fixed percentage of the keys. The keys are scrambled first, so the filter does not correlate with the
+ * partition of a key.
+ */
+struct SelectivityPredicate
+{
+  int64_t selectivity;
+
+  bool operator()(const tuple<int64_t, int64_t> &item) const
+  {
+    return ((uint64_t)get<0>(item) * 0x9E3779B97F4A7C15ULL >> 32) % 100 < (uint64_t)selectivity;
+  }
+};
+
+/**
+ * Keeps every tuple.
+ */
+struct AcceptAll
+{
+  bool operator()(const tuple<int64_t, int64_t> &) const
+  {
+    return true;
+  }
+};
+
+/**
+ * Projects a tuple onto its key.
+ */
+struct KeyProjection
+{
+  typedef int64_t result_type;
+
+  int64_t operator()(const tuple<int64_t, int64_t> &item) const
+  {
+    return get<0>(item);
+  }
+};
+
+/**
+ * Keeps the whole tuple.
+ */
+struct IdentityProjection
+{
+  typedef tuple<int64_t, int64_t> result_type;
+
+  const tuple<int64_t, int64_t> &operator()(const tuple<int64_t, int64_t> &item) const
+  {
+    return item;
+  }
+};
+
+/**
+ * Get the data given a number.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Count the tuples of a chunk that pass the predicate per bucket.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_buckets The number of buckets.
+ * @param predicate The predicate a tuple has to pass.
+ * @param histogram The histogram of the thread.
+ */
+template <typename Predicate>
+void count_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                 Predicate predicate, vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    if (predicate(data[j]))
+    {
+      histogram[get_partition(get<0>(data[j]), num_of_buckets)]++;
+    }
+  }
+}
+
+/**
+ * Scatter the projections of the tuples of a chunk that pass the predicate.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param predicate The predicate a tuple has to pass.
+ * @param projection The projection written for a tuple.
+ * @param offsets The write offsets of the thread.
+ * @param output The output to scatter to.
+ */
+template <typename Predicate, typename Projection>
+void scatter_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                   Predicate predicate, Projection projection, vector<int> &offsets,
+                   vector<typename Projection::result_type> &output)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    if (predicate(data[j]))
+    {
+      output[offsets[get_partition(get<0>(data[j]), num_of_buckets)]++] = projection(data[j]);
+    }
+  }
+}
+
+/**
+ * Partition the projections of the tuples that pass the predicate with a count pass and a scatter pass.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads.
+ * @param num_of_buckets The number of buckets.
+ * @param predicate The predicate a tuple has to pass.
+ * @param projection The projection written for a tuple.
+ * @param output The partitioned projections, sized to the number of tuples that pass.
+ * @param bucket_start The first element of every bucket in the output, followed by the output size.
+ */
+template <typename Predicate, typename Projection>
+void run_partitioning(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads, int num_of_buckets,
+                      Predicate predicate, Projection projection, vector<typename Projection::result_type> &output,
+                      vector<int> &bucket_start)
+{
+  int data_size = data.size();
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk<Predicate>, i, start, end, cref(data), num_of_buckets, predicate,
+                             ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  int offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    bucket_start[b] = offset;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+  }
+  bucket_start[num_of_buckets] = offset;
+  output.resize(offset);
+
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk<Predicate, Projection>, i, start, end, cref(data), num_of_buckets,
+                             predicate, projection, ref(histograms[i]), ref(output)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+}
+
+/**
+ * Filter and project whole partitioned buckets. The survivors of a bucket are written to the front of the bucket's
+ * range in the output. Buckets are handed out to the threads dynamically.
+ * @param thread_id The id of the thread.
+ * @param next_bucket The next bucket to filter, shared by all threads.
+ * @param num_of_buckets The number of buckets.
+ * @param predicate The predicate a tuple has to pass.
+ * @param projection The projection written for a tuple.
+ * @param partitioned The completely partitioned data.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ * @param output The filtered projections.
+ * @param bucket_size The number of survivors of every bucket.
+ */
+template <typename Predicate, typename Projection>
+void filter_buckets(int thread_id, atomic<int> &next_bucket, int num_of_buckets, Predicate predicate,
+                    Projection projection, const vector<tuple<int64_t, int64_t>> &partitioned,
+                    const vector<int> &bucket_start, vector<typename Projection::result_type> &output,
+                    vector<int> &bucket_size)
+{
+  pin_thread(thread_id);
+  for (int b = next_bucket++; b < num_of_buckets; b = next_bucket++)
+  {
+    int offset = bucket_start[b];
+    for (int j = bucket_start[b]; j < bucket_start[b + 1]; j++)
+    {
+      if (predicate(partitioned[j]))
+      {
+        output[offset++] = projection(partitioned[j]);
+      }
+    }
+    bucket_size[b] = offset - bucket_start[b];
+  }
+}
+
+/**
+ * Check that every key is in its bucket and passes the predicate, and that the expected number of keys survived.
+ * @param output The partitioned keys.
+ * @param bucket_start The first key of every bucket, followed by the output size.
+ * @param num_of_buckets The number of buckets.
+ * @param data The input data.
+ * @param predicate The predicate a tuple has to pass.
+ * @return Whether the partitioning is correct.
+ */
+bool verify_output(const vector<int64_t> &output, const vector<int> &bucket_start, int num_of_buckets,
+                   const vector<tuple<int64_t, int64_t>> &data, SelectivityPredicate predicate)
+{
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    for (int j = bucket_start[b]; j < bucket_start[b + 1]; j++)
+    {
+      if (get_partition(output[j], num_of_buckets) != b || !predicate(tuple<int64_t, int64_t>(output[j], output[j])))
+      {
+        return false;
+      }
+    }
+  }
+  return bucket_start[num_of_buckets] == count_if(data.begin(), data.end(), predicate);
+}
+
+/**
+ * Print the output vector.
+ * @param output The partitioned keys.
+ * @param bucket_start The first key of every bucket, followed by the output size.
+ * @param num_of_buckets The number of buckets to use.
+ */
+void print_output(const vector<int64_t> &output, const vector<int> &bucket_start, int num_of_buckets)
+{
+  cout << "Data (first 10 elements from each partition): " << endl;
+  for (int b = 0; b < min(num_of_buckets, 16); b++)
+  {
+    cout << "Partition " << b << " (size: " << bucket_start[b + 1] - bucket_start[b] << "): ";
+    for (int j = bucket_start[b]; j < min(bucket_start[b] + 10, bucket_start[b + 1]); j++)
+    {
+      cout << output[j] << " ";
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [selectivity]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 10" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param selectivity The percentage of tuples that pass the predicate.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  int selectivity)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tSelectivity: " << selectivity << "%" << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc != 6 && argc != 7)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  int selectivity = argc == 7 ? stoi(argv[6]) : 10;
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+  if (selectivity < 1 || selectivity > 100)
+  {
+    cerr << "Error: Selectivity must be between 1 and 100" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, selectivity);
+
+  auto data = get_data_given_n(data_size);
+  SelectivityPredicate predicate = {selectivity};
+
+  vector<int64_t> output;
+  vector<int> bucket_start(num_of_buckets + 1);
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+
+  run_partitioning(data, num_of_threads, num_of_buckets, predicate, KeyProjection(), output, bucket_start);
+
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  // Partition everything, then filter and project every bucket
+  vector<tuple<int64_t, int64_t>> partitioned;
+  vector<int> partitioned_start(num_of_buckets + 1);
+  vector<int64_t> filtered(data_size);
+  vector<int> filtered_size(num_of_buckets);
+
+  auto after_start_time = high_resolution_clock::now();
+  run_partitioning(data, num_of_threads, num_of_buckets, AcceptAll(), IdentityProjection(), partitioned,
+                   partitioned_start);
+  atomic<int> next_bucket(0);
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    threads.push_back(thread(filter_buckets<SelectivityPredicate, KeyProjection>, i, ref(next_bucket), num_of_buckets,
+                             predicate, KeyProjection(), cref(partitioned), cref(partitioned_start), ref(filtered),
+                             ref(filtered_size)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+  auto after_end_time = high_resolution_clock::now();
+  auto after_duration = duration_cast<milliseconds>(after_end_time - after_start_time);
+
+  double pushdown_ms = chrono::duration<double, milli>(end_time - start_time).count();
+  double after_ms = chrono::duration<double, milli>(after_end_time - after_start_time).count();
+  cout << fixed << setprecision(2);
+  cout << "Survivors: " << output.size() << " (" << 100.0 * output.size() / max(1, data_size) << "% of the data)" << endl;
+  cout << "Pushdown: " << pushdown_ms << " ms (" << data_size / pushdown_ms / 1000 << " MT/s)" << endl;
+  cout << "Filter after partitioning: " << after_ms << " ms (" << data_size / after_ms / 1000 << " MT/s)" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    bool same = true;
+    for (int b = 0; b < num_of_buckets; b++)
+    {
+      same = same && filtered_size[b] == bucket_start[b + 1] - bucket_start[b];
+    }
+    cout << "Output verified: " << (verify_output(output, bucket_start, num_of_buckets, data, predicate) && same ? "yes" : "NO") << endl;
+    print_output(output, bucket_start, num_of_buckets);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  string suffix = "-" + to_string(selectivity);
+  append_metrics_to_csv(filename, PROGRAM_NAME + suffix, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+  append_metrics_to_csv(filename, FILTER_AFTER_PROGRAM_NAME + suffix, num_of_threads, num_of_hashbits, num_of_buckets, data_size, after_duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
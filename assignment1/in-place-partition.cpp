@@ -0,0 +1,496 @@
+/**
+ * This program partitions the input array in place, without a second array for the output.
+ * A count pass gives the bucket boundaries. Then all threads permute the array American flag style: a thread claims
+ * the next unprocessed slot of a bucket with an atomic increment of the bucket's head, takes the tuple out of it and
+ * carries it to the next unprocessed slot of its own bucket, taking that tuple out in turn. A slot whose tuple was
+ * carried away is a hole. Once a bucket has no unprocessed slots left, tuples of that bucket go into its holes, which
+ * are kept in a table with one entry per thread, since there are never more holes than tuples being carried.
+ * The extra memory is the histograms, the heads and the hole table. For comparison the program can instead partition
+ * into a separate output array. The peak resident set size is reported next to the throughput.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param in_place (optional) 1 to partition in place, 0 to partition into a separate output array. Defaults to 1.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/resource.h>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "in-place-partition";
+const string OUT_OF_PLACE_PROGRAM_NAME = "out-of-place-partition";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// Marks a free entry of the hole table
+const int NO_HOLE = -1;
+
+/**
+ * Get the data given a number.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Get the peak resident set size of the process.
+ * @return The peak resident set size in bytes.
+ */
+long get_peak_rss()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss * 1024L;
+}
+
+/**
+ * Count the number of tuples per bucket for a chunk.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_buckets The number of buckets.
+ * @param histogram The histogram of the thread.
+ */
+void count_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                 vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    histogram[get_partition(get<0>(data[j]), num_of_buckets)]++;
+  }
+}
+
+/**
+ * Count the data in parallel and compute the bucket boundaries.
+ * @param data The data to count.
+ * @param num_of_threads The number of threads.
+ * @param num_of_buckets The number of buckets.
+ * @param histograms The histograms of the threads.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ */
+void count_buckets(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads, int num_of_buckets,
+                   vector<vector<int>> &histograms, vector<int> &bucket_start)
+{
+  int data_size = data.size();
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, i, start, end, cref(data), num_of_buckets, ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  int offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    bucket_start[b] = offset;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+  }
+  bucket_start[num_of_buckets] = offset;
+}
+
+/**
+ * Record a hole in a free entry of the hole table.
+ * @param holes The hole table.
+ * @param position The position of the hole.
+ */
+void add_hole(vector<atomic<int>> &holes, int position)
+{
+  // There are never more holes than carried tuples, so a free entry exists
+  while (true)
+  {
+    for (auto &hole : holes)
+    {
+      int expected = NO_HOLE;
+      if (hole.load(memory_order_relaxed) == NO_HOLE &&
+          hole.compare_exchange_strong(expected, position, memory_order_release))
+      {
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * Put a tuple into a hole of its bucket. The hole may not be recorded yet if its thread has only just made it.
+ * @param holes The hole table.
+ * @param start The first slot of the bucket.
+ * @param end The end of the bucket.
+ * @param data The data.
+ * @param item The tuple.
+ */
+void fill_hole(vector<atomic<int>> &holes, int start, int end, vector<tuple<int64_t, int64_t>> &data,
+               const tuple<int64_t, int64_t> &item)
+{
+  while (true)
+  {
+    for (auto &hole : holes)
+    {
+      int position = hole.load(memory_order_relaxed);
+      if (position >= start && position < end &&
+          hole.compare_exchange_strong(position, NO_HOLE, memory_order_acquire))
+      {
+        data[position] = item;
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * Permute the data in place into bucket order, together with the other threads. Every thread starts claiming slots in
+ * a different bucket to spread the contention on the heads.
+ * @param thread_id The id of the thread.
+ * @param num_of_threads The number of threads.
+ * @param data The data to permute.
+ * @param num_of_buckets The number of buckets.
+ * @param bucket_start The first slot of every bucket, followed by the data size.
+ * @param heads The next unprocessed slot of every bucket.
+ * @param holes The hole table.
+ */
+void permute_in_place(int thread_id, int num_of_threads, vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                      const vector<int> &bucket_start, vector<atomic<int>> &heads, vector<atomic<int>> &holes)
+{
+  pin_thread(thread_id);
+  int first_bucket = (long)thread_id * num_of_buckets / num_of_threads;
+  for (int k = 0; k < num_of_buckets; k++)
+  {
+    int b = (first_bucket + k) % num_of_buckets;
+    while (heads[b].load(memory_order_relaxed) < bucket_start[b + 1])
+    {
+      int slot = heads[b].fetch_add(1, memory_order_relaxed);
+      if (slot >= bucket_start[b + 1])
+      {
+        break;
+      }
+      tuple<int64_t, int64_t> item = data[slot];
+      int partition = get_partition(get<0>(item), num_of_buckets);
+      if (partition == b)
+      {
+        continue;
+      }
+
+      // Carry the tuple until it goes into a hole, taking out the tuple of every slot it is put into
+      add_hole(holes, slot);
+      while (true)
+      {
+        int end = bucket_start[partition + 1];
+        int target = heads[partition].load(memory_order_relaxed) < end ? heads[partition].fetch_add(1, memory_order_relaxed) : end;
+        if (target >= end)
+        {
+          fill_hole(holes, bucket_start[partition], end, data, item);
+          break;
+        }
+        swap(item, data[target]);
+        partition = get_partition(get<0>(item), num_of_buckets);
+      }
+    }
+  }
+}
+
+/**
+ * Scatter a chunk into a separate output array.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param offsets The write offsets of the thread.
+ * @param output The output to scatter to.
+ */
+void scatter_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                   vector<int> &offsets, vector<tuple<int64_t, int64_t>> &output)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    output[offsets[get_partition(get<0>(data[j]), num_of_buckets)]++] = data[j];
+  }
+}
+
+/**
+ * Check that every tuple is in its bucket and that no tuple was lost or duplicated.
+ * @param output The partitioned data.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ * @param num_of_buckets The number of buckets.
+ * @return Whether the partitioning is correct.
+ */
+bool verify_output(const vector<tuple<int64_t, int64_t>> &output, const vector<int> &bucket_start, int num_of_buckets)
+{
+  vector<bool> seen(output.size() + 1, false);
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    for (int j = bucket_start[b]; j < bucket_start[b + 1]; j++)
+    {
+      int64_t key = get<0>(output[j]);
+      if (get_partition(key, num_of_buckets) != b || key < 1 || key > (int64_t)output.size() || seen[key])
+      {
+        return false;
+      }
+      seen[key] = true;
+    }
+  }
+  return bucket_start[num_of_buckets] == (int)output.size();
+}
+
+/**
+ * Print the output vector.
+ * @param output The partitioned data.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ * @param num_of_buckets The number of buckets to use.
+ */
+void print_output(const vector<tuple<int64_t, int64_t>> &output, const vector<int> &bucket_start, int num_of_buckets)
+{
+  cout << "Data (first 10 elements from each partition): " << endl;
+  for (int b = 0; b < min(num_of_buckets, 16); b++)
+  {
+    cout << "Partition " << b << " (size: " << bucket_start[b + 1] - bucket_start[b] << "): ";
+    for (int j = bucket_start[b]; j < min(bucket_start[b] + 10, bucket_start[b + 1]); j++)
+    {
+      cout << "(" << get<0>(output[j]) << "," << get<1>(output[j]) << ") ";
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [in_place]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 1" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param in_place Whether the data is partitioned in place.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  bool in_place)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tIn place: " << in_place << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc != 6 && argc != 7)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  bool in_place = argc == 7 ? stoi(argv[6]) : true;
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, in_place);
+
+  auto data = get_data_given_n(data_size);
+  long input_rss = get_peak_rss();
+
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+  vector<int> bucket_start(num_of_buckets + 1);
+  vector<tuple<int64_t, int64_t>> output;
+  vector<thread> threads;
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+
+  count_buckets(data, num_of_threads, num_of_buckets, histograms, bucket_start);
+
+  vector<atomic<int>> heads(in_place ? num_of_buckets : 0);
+  vector<atomic<int>> holes(in_place ? num_of_threads : 0);
+  if (in_place)
+  {
+    for (int b = 0; b < num_of_buckets; b++)
+    {
+      heads[b].store(bucket_start[b], memory_order_relaxed);
+    }
+    for (auto &hole : holes)
+    {
+      hole.store(NO_HOLE, memory_order_relaxed);
+    }
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      threads.push_back(thread(permute_in_place, i, num_of_threads, ref(data), num_of_buckets, cref(bucket_start),
+                               ref(heads), ref(holes)));
+    }
+  }
+  else
+  {
+    output.resize(data_size);
+    int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int start = i * chunk_size;
+      int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+      threads.push_back(thread(scatter_chunk, i, start, end, cref(data), num_of_buckets, ref(histograms[i]),
+                               ref(output)));
+    }
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  long peak_rss = get_peak_rss();
+  double partition_ms = chrono::duration<double, milli>(end_time - start_time).count();
+  cout << fixed << setprecision(2);
+  cout << "Throughput: " << data_size / partition_ms / 1000 << " MT/s (" << partition_ms << " ms)" << endl;
+  cout << "Peak RSS: " << peak_rss / 1e6 << " MB (" << (double)peak_rss / max(1L, input_rss) << "x the RSS with only the input)" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  const vector<tuple<int64_t, int64_t>> &partitioned = in_place ? data : output;
+  if (debug)
+  {
+    cout << "Output verified: " << (verify_output(partitioned, bucket_start, num_of_buckets) ? "yes" : "NO") << endl;
+    print_output(partitioned, bucket_start, num_of_buckets);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, in_place ? PROGRAM_NAME : OUT_OF_PLACE_PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
@@ -0,0 +1,724 @@
+/**
+ * This program keeps a partitioned store that grows by appending batches instead of re-partitioning everything.
+ * Every bucket is a list of chunks. A batch is partitioned with a count pass and a scatter pass straight into the free
+ * space at the end of the chunk lists, so appending a batch costs time proportional to the batch, not to the store.
+ * Every few batches, buckets with too many chunks are compacted into a single chunk. Readers take a snapshot of a
+ * bucket (its first chunk and its published size) and scan it while the writer keeps appending and compacting; the
+ * chunks of a snapshot stay alive until the snapshot is released.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param batch_size (optional) The number of tuples appended at once. Defaults to 65536.
+ * @param compaction_interval (optional) The number of batches between compactions, 0 disables compaction.
+ *        Defaults to 16.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "incremental-partition";
+const string REPARTITION_PROGRAM_NAME = "repartition-from-scratch";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// Largest chunk a bucket grows to, unless a single batch needs more room
+const int CHUNK_CAPACITY = 1024;
+
+// Buckets with more chunks than this are compacted
+const int MAX_CHUNKS_PER_BUCKET = 4;
+
+// Smallest number of tuples of a batch worth handing to one more thread
+const int MIN_TUPLES_PER_THREAD = 16384;
+
+/**
+ * A chunk of a bucket. The next chunk is linked before the size of the bucket is published past this chunk.
+ */
+struct Chunk
+{
+  vector<tuple<int64_t, int64_t>> tuples;
+  shared_ptr<Chunk> next;
+
+  explicit Chunk(int capacity) : tuples(capacity) {}
+
+  int capacity() const
+  {
+    return tuples.size();
+  }
+};
+
+/**
+ * The next slot a thread writes to in a bucket.
+ */
+struct Cursor
+{
+  Chunk *chunk;
+  int index;
+};
+
+/**
+ * The partitioned store. The heads and the sizes are read by readers, the rest belongs to the single writer.
+ */
+struct IncrementalStore
+{
+  int num_of_buckets;
+  // First chunk of every bucket, only accessed through atomic_load and atomic_store
+  vector<shared_ptr<Chunk>> heads;
+  // Published number of tuples of every bucket
+  vector<atomic<int64_t>> sizes;
+  // Last chunk of every bucket and the number of tuples in it
+  vector<Chunk *> tails;
+  vector<int> tail_fill;
+  vector<int> chunk_counts;
+  // Per-thread histograms, cursors and touched buckets of the batch being appended. They are kept between batches
+  // and only reset where a batch touched them, so appending does not cost time per bucket.
+  vector<vector<int>> histograms;
+  vector<vector<Cursor>> cursors;
+  vector<vector<int>> touched;
+  // Number of tuples of the batch per bucket and the buckets the batch touched
+  vector<int> batch_totals;
+  vector<int> touched_buckets;
+
+  explicit IncrementalStore(int num_of_buckets)
+      : num_of_buckets(num_of_buckets), heads(num_of_buckets), sizes(num_of_buckets),
+        tails(num_of_buckets, nullptr), tail_fill(num_of_buckets, 0), chunk_counts(num_of_buckets, 0),
+        batch_totals(num_of_buckets, 0)
+  {
+    for (auto &size : sizes)
+    {
+      size.store(0, memory_order_relaxed);
+    }
+  }
+};
+
+/**
+ * A consistent view of a bucket: the tuples published when the snapshot was taken. Holding the snapshot keeps its
+ * chunks alive even if the bucket is compacted in the meantime.
+ */
+class BucketSnapshot
+{
+public:
+  BucketSnapshot(const IncrementalStore &store, int bucket)
+  {
+    // Load the size first: a head loaded afterwards is at least as new and holds at least this many tuples
+    size_ = store.sizes[bucket].load(memory_order_acquire);
+    head_ = atomic_load(&store.heads[bucket]);
+  }
+
+  int64_t size() const
+  {
+    return size_;
+  }
+
+  /**
+   * Call a function for every tuple of the snapshot in append order.
+   * @param function The function to call.
+   */
+  template <typename Function>
+  void for_each(Function function) const
+  {
+    int64_t remaining = size_;
+    const Chunk *chunk = head_.get();
+    while (remaining > 0)
+    {
+      int n = min<int64_t>(remaining, chunk->capacity());
+      for (int j = 0; j < n; j++)
+      {
+        function(chunk->tuples[j]);
+      }
+      remaining -= n;
+      // Only follow the link if the snapshot goes on, the writer may be linking the next chunk right now
+      if (remaining > 0)
+      {
+        chunk = chunk->next.get();
+      }
+    }
+  }
+
+private:
+  shared_ptr<Chunk> head_;
+  int64_t size_;
+};
+
+/**
+ * Get the data given a number.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Count the number of tuples per bucket for a chunk of a batch.
+ * @param thread_id The id of the thread.
+ * @param start The first tuple of the chunk.
+ * @param end The end of the chunk.
+ * @param num_of_buckets The number of buckets.
+ * @param histogram The histogram of the thread, zero for every bucket not in touched.
+ * @param touched The buckets the thread counted a tuple for, in order of their first tuple.
+ */
+void count_chunk(int thread_id, const tuple<int64_t, int64_t> *start, const tuple<int64_t, int64_t> *end,
+                 int num_of_buckets, vector<int> &histogram, vector<int> &touched)
+{
+  pin_thread(thread_id);
+  for (const tuple<int64_t, int64_t> *item = start; item != end; item++)
+  {
+    int bucket = get_partition(get<0>(*item), num_of_buckets);
+    if (histogram[bucket]++ == 0)
+    {
+      touched.push_back(bucket);
+    }
+  }
+}
+
+/**
+ * Scatter a chunk of a batch into the slots reserved for the thread.
+ * @param thread_id The id of the thread.
+ * @param start The first tuple of the chunk.
+ * @param end The end of the chunk.
+ * @param num_of_buckets The number of buckets.
+ * @param cursors The next slot of the thread in every bucket.
+ */
+void scatter_chunk(int thread_id, const tuple<int64_t, int64_t> *start, const tuple<int64_t, int64_t> *end,
+                   int num_of_buckets, vector<Cursor> &cursors)
+{
+  pin_thread(thread_id);
+  for (const tuple<int64_t, int64_t> *item = start; item != end; item++)
+  {
+    Cursor &cursor = cursors[get_partition(get<0>(*item), num_of_buckets)];
+    if (cursor.index == cursor.chunk->capacity())
+    {
+      cursor.chunk = cursor.chunk->next.get();
+      cursor.index = 0;
+    }
+    cursor.chunk->tuples[cursor.index++] = *item;
+  }
+}
+
+/**
+ * Make room for a number of tuples at the end of a bucket. At most one chunk is added, large enough for what does
+ * not fit into the last chunk. The first chunk of a bucket holds exactly what is needed, every later one is at least
+ * twice as large as the last chunk up to CHUNK_CAPACITY, so sparse buckets stay small and busy buckets need few
+ * chunks.
+ * @param store The store.
+ * @param bucket The bucket.
+ * @param count The number of tuples to make room for.
+ */
+void reserve(IncrementalStore &store, int bucket, int count)
+{
+  Chunk *tail = store.tails[bucket];
+  int room = tail ? tail->capacity() - store.tail_fill[bucket] : 0;
+  if (room >= count)
+  {
+    return;
+  }
+  int capacity = tail ? max(count - room, min(CHUNK_CAPACITY, 2 * tail->capacity())) : count;
+  shared_ptr<Chunk> chunk = make_shared<Chunk>(capacity);
+  if (tail)
+  {
+    tail->next = chunk;
+  }
+  else
+  {
+    atomic_store(&store.heads[bucket], chunk);
+  }
+  store.chunk_counts[bucket]++;
+}
+
+/**
+ * Append a batch of tuples to the store and publish it.
+ * @param store The store.
+ * @param batch The first tuple of the batch.
+ * @param batch_size The number of tuples in the batch.
+ * @param num_of_threads The largest number of threads to use.
+ */
+void append_batch(IncrementalStore &store, const tuple<int64_t, int64_t> *batch, int batch_size, int num_of_threads)
+{
+  int num_of_buckets = store.num_of_buckets;
+  num_of_threads = max(1, min(num_of_threads, batch_size / MIN_TUPLES_PER_THREAD));
+  int chunk_size = compute_input_chunk_size(batch_size, num_of_threads);
+  // Only the first batch that uses this many threads allocates their histograms and cursors
+  while ((int)store.histograms.size() < num_of_threads)
+  {
+    store.histograms.push_back(vector<int>(num_of_buckets, 0));
+    store.cursors.push_back(vector<Cursor>(num_of_buckets));
+    store.touched.push_back(vector<int>());
+  }
+
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? batch_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, i, batch + start, batch + end, num_of_buckets, ref(store.histograms[i]),
+                             ref(store.touched[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  store.touched_buckets.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    for (int b : store.touched[i])
+    {
+      if (store.batch_totals[b] == 0)
+      {
+        store.touched_buckets.push_back(b);
+      }
+      store.batch_totals[b] += store.histograms[i][b];
+    }
+  }
+
+  // Reserve the space of every touched bucket and give every thread its first slot, in thread order so appends stay
+  // ordered
+  for (int b : store.touched_buckets)
+  {
+    reserve(store, b, store.batch_totals[b]);
+
+    Cursor cursor = {store.tails[b], store.tail_fill[b]};
+    if (!cursor.chunk)
+    {
+      cursor.chunk = store.heads[b].get();
+    }
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      store.cursors[i][b] = cursor;
+      cursor.index += store.histograms[i][b];
+      if (cursor.index > cursor.chunk->capacity())
+      {
+        cursor.index -= cursor.chunk->capacity();
+        cursor.chunk = cursor.chunk->next.get();
+      }
+    }
+    if (cursor.index == cursor.chunk->capacity() && cursor.chunk->next)
+    {
+      cursor.chunk = cursor.chunk->next.get();
+      cursor.index = 0;
+    }
+    store.tails[b] = cursor.chunk;
+    store.tail_fill[b] = cursor.index;
+  }
+
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? batch_size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk, i, batch + start, batch + end, num_of_buckets, ref(store.cursors[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  // Publish the touched buckets and reset their counts for the next batch
+  for (int b : store.touched_buckets)
+  {
+    store.sizes[b].store(store.sizes[b].load(memory_order_relaxed) + store.batch_totals[b], memory_order_release);
+    store.batch_totals[b] = 0;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      store.histograms[i][b] = 0;
+    }
+  }
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    store.touched[i].clear();
+  }
+}
+
+/**
+ * Compact the buckets with too many chunks into a single chunk each. Buckets are handed out dynamically. Snapshots of
+ * the old chunks stay valid, the old chunks are freed when the last snapshot is released.
+ * @param thread_id The id of the thread.
+ * @param next_bucket The next bucket to look at, shared by all threads.
+ * @param store The store.
+ * @param compacted The number of buckets compacted by the thread.
+ */
+void compact_buckets(int thread_id, atomic<int> &next_bucket, IncrementalStore &store, int &compacted)
+{
+  pin_thread(thread_id);
+  for (int b = next_bucket++; b < store.num_of_buckets; b = next_bucket++)
+  {
+    if (store.chunk_counts[b] <= MAX_CHUNKS_PER_BUCKET)
+    {
+      continue;
+    }
+    int64_t size = store.sizes[b].load(memory_order_relaxed);
+    shared_ptr<Chunk> chunk = make_shared<Chunk>(size);
+    int64_t offset = 0;
+    for (const Chunk *old = store.heads[b].get(); offset < size; old = old->next.get())
+    {
+      int n = min<int64_t>(size - offset, old->capacity());
+      copy(old->tuples.begin(), old->tuples.begin() + n, chunk->tuples.begin() + offset);
+      offset += n;
+    }
+    store.tails[b] = chunk.get();
+    store.tail_fill[b] = size;
+    store.chunk_counts[b] = 1;
+    atomic_store(&store.heads[b], chunk);
+    compacted++;
+  }
+}
+
+/**
+ * Compact the buckets of the store in parallel.
+ * @param store The store.
+ * @param num_of_threads The number of threads.
+ * @return The number of buckets compacted.
+ */
+int compact(IncrementalStore &store, int num_of_threads)
+{
+  atomic<int> next_bucket(0);
+  vector<int> compacted(num_of_threads, 0);
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    threads.push_back(thread(compact_buckets, i, ref(next_bucket), ref(store), ref(compacted[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+  int total = 0;
+  for (int c : compacted)
+  {
+    total += c;
+  }
+  return total;
+}
+
+/**
+ * Check that a snapshot only holds tuples of its bucket, in append order.
+ * @param snapshot The snapshot to check.
+ * @param bucket The bucket of the snapshot.
+ * @param num_of_buckets The number of buckets.
+ * @return Whether the snapshot is consistent.
+ */
+bool verify_snapshot(const BucketSnapshot &snapshot, int bucket, int num_of_buckets)
+{
+  bool valid = true;
+  int64_t previous = 0;
+  snapshot.for_each([&](const tuple<int64_t, int64_t> &item)
+                    {
+                      valid = valid && get_partition(get<0>(item), num_of_buckets) == bucket && get<0>(item) > previous;
+                      previous = get<0>(item);
+                    });
+  return valid;
+}
+
+/**
+ * Keep scanning snapshots of the buckets while the store is written.
+ * @param store The store.
+ * @param done Set when the writer is done.
+ * @param scans The number of snapshots scanned.
+ * @param inconsistent The number of inconsistent snapshots.
+ */
+void read_snapshots(const IncrementalStore &store, const atomic<bool> &done, long &scans, long &inconsistent)
+{
+  for (int b = 0; !done.load(memory_order_acquire); b = (b + 1) % store.num_of_buckets)
+  {
+    BucketSnapshot snapshot(store, b);
+    if (!verify_snapshot(snapshot, b, store.num_of_buckets))
+    {
+      inconsistent++;
+    }
+    scans++;
+  }
+}
+
+/**
+ * Check that every tuple is in its bucket, in append order, and that no tuple was lost.
+ * @param store The store.
+ * @param data_size The size of the data.
+ * @return Whether the store is correct.
+ */
+bool verify_output(const IncrementalStore &store, int data_size)
+{
+  long total = 0;
+  for (int b = 0; b < store.num_of_buckets; b++)
+  {
+    BucketSnapshot snapshot(store, b);
+    if (!verify_snapshot(snapshot, b, store.num_of_buckets))
+    {
+      return false;
+    }
+    total += snapshot.size();
+  }
+  return total == data_size;
+}
+
+/**
+ * Print the output vector.
+ * @param store The store.
+ */
+void print_output(const IncrementalStore &store)
+{
+  cout << "Data (first 10 elements from each partition): " << endl;
+  for (int b = 0; b < min(store.num_of_buckets, 16); b++)
+  {
+    BucketSnapshot snapshot(store, b);
+    cout << "Partition " << b << " (size: " << snapshot.size() << ", chunks: " << store.chunk_counts[b] << "): ";
+    int printed = 0;
+    snapshot.for_each([&](const tuple<int64_t, int64_t> &item)
+                      {
+                        if (printed++ < 10)
+                        {
+                          cout << "(" << get<0>(item) << "," << get<1>(item) << ") ";
+                        }
+                      });
+    cout << endl;
+  }
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [batch_size] [compaction_interval]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 65536 16" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param batch_size The number of tuples appended at once.
+ * @param compaction_interval The number of batches between compactions.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  int batch_size, int compaction_interval)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tBatch size: " << batch_size << endl;
+  cout << "\tCompaction interval: " << compaction_interval << " batches" << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc < 6 || argc > 8)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  int batch_size = argc >= 7 ? stoi(argv[6]) : 65536;
+  int compaction_interval = argc >= 8 ? stoi(argv[7]) : 16;
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+  if (batch_size < 1 || compaction_interval < 0)
+  {
+    cerr << "Error: Batch size must be positive and the compaction interval not negative" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, batch_size, compaction_interval);
+
+  auto data = get_data_given_n(data_size);
+  IncrementalStore store(num_of_buckets);
+
+  // A reader scans snapshots during the whole run
+  atomic<bool> done(false);
+  long scans = 0;
+  long inconsistent = 0;
+  thread reader(read_snapshots, cref(store), cref(done), ref(scans), ref(inconsistent));
+
+  vector<double> batch_ms;
+  double compaction_ms = 0;
+  int compacted = 0;
+  int compaction_errors = 0;
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+
+  for (int start = 0, batch = 1; start < data_size; start += batch_size, batch++)
+  {
+    auto batch_start_time = high_resolution_clock::now();
+    append_batch(store, &data[start], min(batch_size, data_size - start), num_of_threads);
+    auto batch_end_time = high_resolution_clock::now();
+    batch_ms.push_back(chrono::duration<double, milli>(batch_end_time - batch_start_time).count());
+
+    if (compaction_interval > 0 && batch % compaction_interval == 0)
+    {
+      compacted += compact(store, num_of_threads);
+      compaction_ms += chrono::duration<double, milli>(high_resolution_clock::now() - batch_end_time).count();
+      // Check that compacting kept every tuple published so far, in order
+      if (debug && !verify_output(store, min(data_size, start + batch_size)))
+      {
+        compaction_errors++;
+      }
+    }
+  }
+
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  done.store(true, memory_order_release);
+  reader.join();
+
+  // Partitioning everything at once, which is what every batch would cost without the store
+  auto repartition_start_time = high_resolution_clock::now();
+  {
+    IncrementalStore repartitioned(num_of_buckets);
+    append_batch(repartitioned, data.data(), data_size, num_of_threads);
+  }
+  auto repartition_end_time = high_resolution_clock::now();
+  auto repartition_duration = duration_cast<milliseconds>(repartition_end_time - repartition_start_time);
+
+  int quarter = max<int>(1, batch_ms.size() / 4);
+  double first_quarter_ms = 0;
+  double last_quarter_ms = 0;
+  for (int i = 0; i < quarter && i < (int)batch_ms.size(); i++)
+  {
+    first_quarter_ms += batch_ms[i];
+    last_quarter_ms += batch_ms[batch_ms.size() - 1 - i];
+  }
+
+  cout << fixed << setprecision(3);
+  cout << "Batches: " << batch_ms.size() << endl;
+  cout << "Append per batch: " << first_quarter_ms / quarter << " ms (first quarter), " << last_quarter_ms / quarter
+       << " ms (last quarter)" << endl;
+  cout << "Compaction: " << compaction_ms << " ms (" << compacted << " buckets compacted)" << endl;
+  cout << "Repartitioning everything at once: "
+       << chrono::duration<double, milli>(repartition_end_time - repartition_start_time).count() << " ms" << endl;
+  cout << "Snapshots scanned while writing: " << scans << " (" << inconsistent << " inconsistent)" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    cout << "Output verified: "
+         << (verify_output(store, data_size) && inconsistent == 0 && compaction_errors == 0 ? "yes" : "NO") << endl;
+    print_output(store);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+  append_metrics_to_csv(filename, REPARTITION_PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, repartition_duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
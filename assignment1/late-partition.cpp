@@ -0,0 +1,478 @@
+/**
+ * This program partitions only the keys and the row ids of the tuples and gathers the payloads later.
+ * The scatter moves a 64-bit key and a 32-bit row id per tuple instead of the whole 16-byte tuple. Afterwards the
+ * payloads of the buckets a consumer needs are gathered from the original data, bucket by bucket in parallel, with the
+ * rows a few positions ahead prefetched. For comparison the same data is partitioned with full tuples.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param gather_percent (optional) The percentage of the buckets whose payloads are gathered, 0 to 100.
+ *        Defaults to 100.
+ * @param prefetch_distance (optional) How many rows ahead the gather prefetches, 0 disables prefetching.
+ *        Defaults to 16.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "late-materialization";
+const string FULL_TUPLE_PROGRAM_NAME = "full-tuple-partition";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+/**
+ * The keys and row ids of the partitioned tuples, stored as separate columns, and the gathered payloads.
+ */
+struct LatePartitions
+{
+  vector<int64_t> keys;
+  vector<uint32_t> row_ids;
+  vector<int64_t> payloads;
+  // The first tuple of every bucket, followed by the data size
+  vector<int> bucket_start;
+};
+
+/**
+ * Get the data given a number.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Count the number of tuples per bucket for a chunk.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_buckets The number of buckets.
+ * @param histogram The histogram of the thread.
+ */
+void count_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                 vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    histogram[get_partition(get<0>(data[j]), num_of_buckets)]++;
+  }
+}
+
+/**
+ * Scatter the keys and the row ids of a chunk.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param offsets The write offsets of the thread.
+ * @param partitions The partitions to scatter to.
+ */
+void scatter_row_ids(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data,
+                     int num_of_buckets, vector<int> &offsets, LatePartitions &partitions)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    int offset = offsets[get_partition(get<0>(data[j]), num_of_buckets)]++;
+    partitions.keys[offset] = get<0>(data[j]);
+    partitions.row_ids[offset] = j;
+  }
+}
+
+/**
+ * Scatter the full tuples of a chunk.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param offsets The write offsets of the thread.
+ * @param output The output to scatter to.
+ */
+void scatter_tuples(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                    vector<int> &offsets, vector<tuple<int64_t, int64_t>> &output)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    output[offsets[get_partition(get<0>(data[j]), num_of_buckets)]++] = data[j];
+  }
+}
+
+/**
+ * Count the data and turn the histograms into the write offsets of every thread.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads.
+ * @param num_of_buckets The number of buckets.
+ * @param histograms The histograms, replaced by the write offsets.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ */
+void count_and_prefix_sum(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads, int num_of_buckets,
+                          vector<vector<int>> &histograms, vector<int> &bucket_start)
+{
+  int data_size = data.size();
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, i, start, end, cref(data), num_of_buckets, ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  int offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    bucket_start[b] = offset;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+  }
+  bucket_start[num_of_buckets] = offset;
+}
+
+/**
+ * Gather the payloads of whole buckets from the original data. Buckets are handed out to the threads dynamically.
+ * @param thread_id The id of the thread.
+ * @param next_bucket The next bucket to gather, shared by all threads.
+ * @param num_of_gathered_buckets The number of buckets to gather, starting at bucket 0.
+ * @param prefetch_distance How many rows ahead to prefetch, 0 to not prefetch.
+ * @param data The original data.
+ * @param partitions The partitions to gather the payloads of.
+ */
+void gather_buckets(int thread_id, atomic<int> &next_bucket, int num_of_gathered_buckets, int prefetch_distance,
+                    const vector<tuple<int64_t, int64_t>> &data, LatePartitions &partitions)
+{
+  pin_thread(thread_id);
+  for (int b = next_bucket++; b < num_of_gathered_buckets; b = next_bucket++)
+  {
+    int start = partitions.bucket_start[b];
+    int end = partitions.bucket_start[b + 1];
+    for (int j = start; j < end; j++)
+    {
+      if (prefetch_distance > 0 && j + prefetch_distance < end)
+      {
+        __builtin_prefetch(&data[partitions.row_ids[j + prefetch_distance]], 0);
+      }
+      partitions.payloads[j] = get<1>(data[partitions.row_ids[j]]);
+    }
+  }
+}
+
+/**
+ * Check that every key is in its bucket and that the gathered payloads belong to their keys.
+ * @param partitions The partitioned data.
+ * @param num_of_buckets The number of buckets.
+ * @param num_of_gathered_buckets The number of buckets whose payloads were gathered.
+ * @param data The original data.
+ * @return Whether the partitioning is correct.
+ */
+bool verify_output(const LatePartitions &partitions, int num_of_buckets, int num_of_gathered_buckets,
+                   const vector<tuple<int64_t, int64_t>> &data)
+{
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    for (int j = partitions.bucket_start[b]; j < partitions.bucket_start[b + 1]; j++)
+    {
+      if (get_partition(partitions.keys[j], num_of_buckets) != b ||
+          get<0>(data[partitions.row_ids[j]]) != partitions.keys[j] ||
+          (b < num_of_gathered_buckets && partitions.payloads[j] != get<1>(data[partitions.row_ids[j]])))
+      {
+        return false;
+      }
+    }
+  }
+  return partitions.bucket_start[num_of_buckets] == (int)data.size();
+}
+
+/**
+ * Print the output vector.
+ * @param partitions The partitioned data.
+ * @param num_of_buckets The number of buckets to use.
+ * @param num_of_gathered_buckets The number of buckets whose payloads were gathered.
+ */
+void print_output(const LatePartitions &partitions, int num_of_buckets, int num_of_gathered_buckets)
+{
+  cout << "Data (first 10 elements from each partition, as key:row_id[:payload]): " << endl;
+  for (int b = 0; b < min(num_of_buckets, 16); b++)
+  {
+    int start = partitions.bucket_start[b];
+    int end = partitions.bucket_start[b + 1];
+    cout << "Partition " << b << " (size: " << end - start << "): ";
+    for (int j = start; j < min(start + 10, end); j++)
+    {
+      cout << partitions.keys[j] << ":" << partitions.row_ids[j];
+      if (b < num_of_gathered_buckets)
+      {
+        cout << ":" << partitions.payloads[j];
+      }
+      cout << " ";
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [gather_percent] [prefetch_distance]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 100 16" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param gather_percent The percentage of the buckets whose payloads are gathered.
+ * @param prefetch_distance How many rows ahead the gather prefetches.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  int gather_percent, int prefetch_distance)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tGathered buckets: " << gather_percent << "%" << endl;
+  cout << "\tPrefetch distance: " << prefetch_distance << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc < 6 || argc > 8)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  int gather_percent = argc >= 7 ? stoi(argv[6]) : 100;
+  int prefetch_distance = argc >= 8 ? stoi(argv[7]) : 16;
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+  if (gather_percent < 0 || gather_percent > 100 || prefetch_distance < 0)
+  {
+    cerr << "Error: The gathered percentage must be between 0 and 100 and the prefetch distance not negative" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, gather_percent, prefetch_distance);
+
+  auto data = get_data_given_n(data_size);
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  int num_of_gathered_buckets = ((long)num_of_buckets * gather_percent + 99) / 100;
+
+  LatePartitions partitions;
+  partitions.keys.resize(data_size);
+  partitions.row_ids.resize(data_size);
+  partitions.payloads.resize(data_size);
+  partitions.bucket_start.resize(num_of_buckets + 1);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+  vector<thread> threads;
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+
+  count_and_prefix_sum(data, num_of_threads, num_of_buckets, histograms, partitions.bucket_start);
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_row_ids, i, start, end, cref(data), num_of_buckets, ref(histograms[i]),
+                             ref(partitions)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  auto scatter_time = high_resolution_clock::now();
+
+  atomic<int> next_bucket(0);
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    threads.push_back(thread(gather_buckets, i, ref(next_bucket), num_of_gathered_buckets, prefetch_distance,
+                             cref(data), ref(partitions)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  // Partition the full tuples for comparison
+  vector<tuple<int64_t, int64_t>> output(data_size);
+  vector<int> bucket_start(num_of_buckets + 1);
+  vector<vector<int>> full_histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+
+  auto full_start_time = high_resolution_clock::now();
+  count_and_prefix_sum(data, num_of_threads, num_of_buckets, full_histograms, bucket_start);
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_tuples, i, start, end, cref(data), num_of_buckets, ref(full_histograms[i]),
+                             ref(output)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+  auto full_end_time = high_resolution_clock::now();
+  auto full_duration = duration_cast<milliseconds>(full_end_time - full_start_time);
+
+  double full_ms = chrono::duration<double, milli>(full_end_time - full_start_time).count();
+  double late_ms = chrono::duration<double, milli>(end_time - start_time).count();
+  cout << fixed << setprecision(2);
+  cout << "Row id partitioning: " << chrono::duration<double, milli>(scatter_time - start_time).count() << " ms" << endl;
+  cout << "Gather of " << num_of_gathered_buckets << " buckets: "
+       << chrono::duration<double, milli>(end_time - scatter_time).count() << " ms" << endl;
+  cout << "Late materialization: " << late_ms << " ms (" << data_size / late_ms / 1000 << " MT/s)" << endl;
+  cout << "Full tuples: " << full_ms << " ms (" << data_size / full_ms / 1000 << " MT/s)" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    cout << "Output verified: " << (verify_output(partitions, num_of_buckets, num_of_gathered_buckets, data) ? "yes" : "NO") << endl;
+    print_output(partitions, num_of_buckets, num_of_gathered_buckets);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, PROGRAM_NAME + "-" + to_string(gather_percent), num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+  append_metrics_to_csv(filename, FULL_TUPLE_PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, full_duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
@@ -0,0 +1,665 @@
+/**
+ * This program measures partitioning as an online service would use it: many small batches, one per request.
+ * A PartitionPool keeps its worker threads warm and its histograms and output preallocated for the largest batch, and
+ * partitions a batch on the calling thread alone when the batch is smaller than the parallel threshold. A built-in
+ * load generator partitions batches of 1K to 64K tuples with the pool and, as a baseline, with threads created for
+ * every batch, and records every batch in a log-linear latency histogram to report p50, p99 and p99.9.
+ * @param num_of_threads The number of threads used, including the calling thread.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The number of tuples the batches are taken from.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param parallel_threshold (optional) The smallest batch partitioned by all threads. Defaults to 16384.
+ * @param num_of_batches (optional) The number of batches measured per batch size. Defaults to 2000.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "microbatch";
+const string SPAWN_PROGRAM_NAME = "spawn-per-batch";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// The batch sizes of the load generator
+const int BATCH_SIZES[] = {1024, 4096, 16384, 65536};
+
+// Batches partitioned before the measurement starts, per batch size
+const int WARMUP_BATCHES = 16;
+
+/**
+ * A latency histogram with a fixed memory footprint in the style of HdrHistogram.
+ * Values below 2^SUB_BUCKET_BITS are counted exactly; above that every power of two is split into 2^SUB_BUCKET_BITS
+ * linear sub-buckets, so a reported value is within about 3% of the recorded one.
+ */
+class LatencyHistogram
+{
+public:
+  static const int SUB_BUCKET_BITS = 5;
+
+  LatencyHistogram() : counts((64 - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS, 0), total(0), max_value(0) {}
+
+  void record(int64_t value)
+  {
+    counts[index_of(max<int64_t>(value, 0))]++;
+    total++;
+    max_value = max(max_value, value);
+  }
+
+  /**
+   * Get a percentile.
+   * @param percentile The percentile to get, between 0 and 100.
+   * @return The highest value that falls in the same sub-bucket as the percentile.
+   */
+  int64_t percentile(double percentile) const
+  {
+    if (total == 0)
+    {
+      return 0;
+    }
+    int64_t rank = max<int64_t>(1, (int64_t)(percentile / 100 * total + 0.5));
+    int64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+      seen += counts[i];
+      if (seen >= rank)
+      {
+        return min(highest_value_of(i), max_value);
+      }
+    }
+    return max_value;
+  }
+
+  int64_t count() const
+  {
+    return total;
+  }
+
+  int64_t maximum() const
+  {
+    return max_value;
+  }
+
+private:
+  static size_t index_of(int64_t value)
+  {
+    if (value < (1 << SUB_BUCKET_BITS))
+    {
+      return value;
+    }
+    int magnitude = 63 - __builtin_clzll(value);
+    int64_t sub_bucket = value >> (magnitude - SUB_BUCKET_BITS);
+    return ((size_t)(magnitude - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) + (sub_bucket - (1 << SUB_BUCKET_BITS));
+  }
+
+  static int64_t highest_value_of(size_t index)
+  {
+    if (index < (1 << SUB_BUCKET_BITS))
+    {
+      return index;
+    }
+    int shift = (index >> SUB_BUCKET_BITS) - 1;
+    int64_t sub_bucket = (index & ((1 << SUB_BUCKET_BITS) - 1)) + (1 << SUB_BUCKET_BITS);
+    return ((sub_bucket + 1) << shift) - 1;
+  }
+
+  vector<int64_t> counts;
+  int64_t total;
+  int64_t max_value;
+};
+
+/**
+ * Get the data given a number.
+ * @param n The number of tuples to generate.
+ * @return The data given the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Count the number of tuples per bucket for a chunk.
+ * @param batch The batch.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param num_of_buckets The number of buckets.
+ * @param histogram The histogram to count into, cleared first.
+ */
+void count_chunk(const tuple<int64_t, int64_t> *batch, int start, int end, int num_of_buckets, vector<int> &histogram)
+{
+  fill(histogram.begin(), histogram.end(), 0);
+  for (int j = start; j < end; j++)
+  {
+    histogram[get_partition(get<0>(batch[j]), num_of_buckets)]++;
+  }
+}
+
+/**
+ * Scatter a chunk.
+ * @param batch The batch.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param num_of_buckets The number of buckets.
+ * @param offsets The write offsets of the chunk.
+ * @param output The output to scatter to.
+ */
+void scatter_chunk(const tuple<int64_t, int64_t> *batch, int start, int end, int num_of_buckets, vector<int> &offsets,
+                   tuple<int64_t, int64_t> *output)
+{
+  for (int j = start; j < end; j++)
+  {
+    output[offsets[get_partition(get<0>(batch[j]), num_of_buckets)]++] = batch[j];
+  }
+}
+
+/**
+ * Turn the histograms of the chunks into write offsets.
+ * @param histograms The histograms, replaced by the write offsets.
+ * @param num_of_chunks The number of histograms to use.
+ * @param bucket_start The first tuple of every bucket, followed by the batch size.
+ */
+void compute_offsets(vector<vector<int>> &histograms, int num_of_chunks, vector<int> &bucket_start)
+{
+  int num_of_buckets = bucket_start.size() - 1;
+  int offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    bucket_start[b] = offset;
+    for (int i = 0; i < num_of_chunks; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+  }
+  bucket_start[num_of_buckets] = offset;
+}
+
+/**
+ * Partitions batches with warm threads into preallocated storage.
+ * The calling thread takes part as thread 0. The other threads spin between batches, so a batch starts without a
+ * wake-up, and the count pass, the offset computation and the scatter pass are separated by counters instead of joins.
+ * The output of a batch is valid until the next call.
+ */
+class PartitionPool
+{
+public:
+  /**
+   * Create a pool.
+   * @param num_of_threads The number of threads, including the calling thread.
+   * @param num_of_buckets The number of buckets.
+   * @param max_batch_size The largest batch that will be partitioned.
+   * @param parallel_threshold The smallest batch partitioned by all threads.
+   */
+  PartitionPool(int num_of_threads, int num_of_buckets, int max_batch_size, int parallel_threshold)
+      : num_of_threads(num_of_threads), num_of_buckets(num_of_buckets), parallel_threshold(parallel_threshold),
+        histograms(num_of_threads, vector<int>(num_of_buckets)), output_(max_batch_size),
+        bucket_start_(num_of_buckets + 1), batch(nullptr), batch_size(0), epoch(0), offsets_epoch(0), counted(0),
+        scattered(0), stop(false)
+  {
+    pin_thread(0);
+    for (int i = 1; i < num_of_threads; i++)
+    {
+      workers.push_back(thread(&PartitionPool::worker_loop, this, i));
+    }
+  }
+
+  ~PartitionPool()
+  {
+    stop.store(true, memory_order_release);
+    for (auto &t : workers)
+    {
+      t.join();
+    }
+  }
+
+  /**
+   * Partition a batch.
+   * @param tuples The tuples of the batch.
+   * @param size The number of tuples, at most the largest batch size of the pool.
+   * @return Whether all threads were used.
+   */
+  bool partition(const tuple<int64_t, int64_t> *tuples, int size)
+  {
+    batch = tuples;
+    batch_size = size;
+    if (size < parallel_threshold || num_of_threads == 1)
+    {
+      count_chunk(batch, 0, size, num_of_buckets, histograms[0]);
+      compute_offsets(histograms, 1, bucket_start_);
+      scatter_chunk(batch, 0, size, num_of_buckets, histograms[0], output_.data());
+      return false;
+    }
+
+    // The workers are done with the previous batch, so the counters can be reset before the batch is published
+    counted.store(0, memory_order_relaxed);
+    scattered.store(0, memory_order_relaxed);
+    int64_t current = epoch.load(memory_order_relaxed) + 1;
+    epoch.store(current, memory_order_release);
+
+    count_part(0);
+    wait_for(counted, num_of_threads - 1);
+    compute_offsets(histograms, num_of_threads, bucket_start_);
+    offsets_epoch.store(current, memory_order_release);
+    scatter_part(0);
+    wait_for(scattered, num_of_threads - 1);
+    return true;
+  }
+
+  const tuple<int64_t, int64_t> *output() const
+  {
+    return output_.data();
+  }
+
+  const vector<int> &bucket_start() const
+  {
+    return bucket_start_;
+  }
+
+private:
+  void worker_loop(int thread_id)
+  {
+    pin_thread(thread_id);
+    int64_t seen = 0;
+    for (;;)
+    {
+      int64_t current;
+      while ((current = epoch.load(memory_order_acquire)) == seen)
+      {
+        if (stop.load(memory_order_acquire))
+        {
+          return;
+        }
+        this_thread::yield();
+      }
+      seen = current;
+      count_part(thread_id);
+      counted.fetch_add(1, memory_order_acq_rel);
+      while (offsets_epoch.load(memory_order_acquire) != seen)
+      {
+        this_thread::yield();
+      }
+      scatter_part(thread_id);
+      scattered.fetch_add(1, memory_order_acq_rel);
+    }
+  }
+
+  void count_part(int thread_id)
+  {
+    int chunk_size = compute_input_chunk_size(batch_size, num_of_threads);
+    int start = thread_id * chunk_size;
+    int end = (thread_id == num_of_threads - 1) ? batch_size : start + chunk_size;
+    count_chunk(batch, start, end, num_of_buckets, histograms[thread_id]);
+  }
+
+  void scatter_part(int thread_id)
+  {
+    int chunk_size = compute_input_chunk_size(batch_size, num_of_threads);
+    int start = thread_id * chunk_size;
+    int end = (thread_id == num_of_threads - 1) ? batch_size : start + chunk_size;
+    scatter_chunk(batch, start, end, num_of_buckets, histograms[thread_id], output_.data());
+  }
+
+  static void wait_for(const atomic<int> &counter, int target)
+  {
+    while (counter.load(memory_order_acquire) < target)
+    {
+      this_thread::yield();
+    }
+  }
+
+  int num_of_threads;
+  int num_of_buckets;
+  int parallel_threshold;
+  vector<vector<int>> histograms;
+  vector<tuple<int64_t, int64_t>> output_;
+  vector<int> bucket_start_;
+  const tuple<int64_t, int64_t> *batch;
+  int batch_size;
+  // Batches are published by increasing the epoch, the offsets of a batch by setting offsets_epoch to its epoch
+  alignas(64) atomic<int64_t> epoch;
+  alignas(64) atomic<int64_t> offsets_epoch;
+  alignas(64) atomic<int> counted;
+  alignas(64) atomic<int> scattered;
+  atomic<bool> stop;
+  vector<thread> workers;
+};
+
+/**
+ * Partition a batch the way the other programs do: with new threads and new storage.
+ * @param batch The tuples of the batch.
+ * @param size The number of tuples.
+ * @param num_of_threads The number of threads.
+ * @param num_of_buckets The number of buckets.
+ * @param output The partitioned batch.
+ * @param bucket_start The first tuple of every bucket, followed by the batch size.
+ */
+void spawn_partition(const tuple<int64_t, int64_t> *batch, int size, int num_of_threads, int num_of_buckets,
+                     vector<tuple<int64_t, int64_t>> &output, vector<int> &bucket_start)
+{
+  int chunk_size = compute_input_chunk_size(size, num_of_threads);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets));
+  output.assign(size, tuple<int64_t, int64_t>());
+  bucket_start.assign(num_of_buckets + 1, 0);
+
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? size : start + chunk_size;
+    threads.push_back(thread(count_chunk, batch, start, end, num_of_buckets, ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  compute_offsets(histograms, num_of_threads, bucket_start);
+
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk, batch, start, end, num_of_buckets, ref(histograms[i]), output.data()));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+}
+
+/**
+ * Verify a partitioned batch: every tuple is in its bucket and every tuple of the batch is there.
+ * @param output The partitioned batch.
+ * @param bucket_start The first tuple of every bucket, followed by the batch size.
+ * @param batch The tuples of the batch.
+ * @param size The number of tuples.
+ * @return True if the batch is partitioned correctly, false otherwise.
+ */
+bool verify_output(const tuple<int64_t, int64_t> *output, const vector<int> &bucket_start,
+                   const tuple<int64_t, int64_t> *batch, int size)
+{
+  int num_of_buckets = bucket_start.size() - 1;
+  int64_t output_sum = 0;
+  int64_t batch_sum = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    for (int j = bucket_start[b]; j < bucket_start[b + 1]; j++)
+    {
+      if (get_partition(get<0>(output[j]), num_of_buckets) != b)
+      {
+        return false;
+      }
+      output_sum += get<0>(output[j]);
+    }
+  }
+  for (int j = 0; j < size; j++)
+  {
+    batch_sum += get<0>(batch[j]);
+  }
+  return bucket_start[num_of_buckets] == size && output_sum == batch_sum;
+}
+
+/**
+ * Print the latencies of a batch size.
+ * @param name The name of the execution.
+ * @param batch_size The batch size.
+ * @param histogram The latencies in nanoseconds.
+ * @param total_ns The time of all measured batches.
+ */
+void print_latencies(const string &name, int batch_size, const LatencyHistogram &histogram, int64_t total_ns)
+{
+  cout << fixed << setprecision(1);
+  cout << "\t" << name << " " << batch_size << " (us): p50 " << histogram.percentile(50) / 1e3
+       << ", p99 " << histogram.percentile(99) / 1e3
+       << ", p99.9 " << histogram.percentile(99.9) / 1e3
+       << ", max " << histogram.maximum() / 1e3
+       << ", " << histogram.count() * (double)batch_size / total_ns * 1e3 << " M tuples/s" << endl;
+  cout.unsetf(ios_base::floatfield);
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [parallel_threshold] [num_of_batches]" << endl;
+  cout << "Example: " << program_name << " 4 8 16777216 metrics.csv 0 16384 2000" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param parallel_threshold The smallest batch partitioned by all threads.
+ * @param num_of_batches The number of batches measured per batch size.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  int parallel_threshold, int num_of_batches)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tParallel threshold: " << parallel_threshold << endl;
+  cout << "\tBatches per batch size: " << num_of_batches << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc < 6 || argc > 8)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  int parallel_threshold = argc >= 7 ? stoi(argv[6]) : 16384;
+  int num_of_batches = argc >= 8 ? stoi(argv[7]) : 2000;
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+  int max_batch_size = *max_element(begin(BATCH_SIZES), end(BATCH_SIZES));
+  if (data_size < max_batch_size)
+  {
+    cerr << "Error: The data size must be at least the largest batch size (" << max_batch_size << ")" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, parallel_threshold, num_of_batches);
+
+  auto data = get_data_given_n(data_size);
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  PartitionPool pool(num_of_threads, num_of_buckets, max_batch_size, parallel_threshold);
+  vector<tuple<int64_t, int64_t>> spawn_output;
+  vector<int> spawn_bucket_start;
+  bool verified = true;
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+
+  cout << "Batch latencies:" << endl;
+  for (int batch_size : BATCH_SIZES)
+  {
+    LatencyHistogram pool_latencies;
+    LatencyHistogram spawn_latencies;
+    int64_t pool_total_ns = 0;
+    int64_t spawn_total_ns = 0;
+    bool parallel = false;
+
+    // Consecutive batches come from consecutive slices of the data, as if they were different requests
+    int num_of_slices = data_size / batch_size;
+    for (int i = -WARMUP_BATCHES; i < num_of_batches; i++)
+    {
+      const tuple<int64_t, int64_t> *batch = data.data() + (size_t)((i + WARMUP_BATCHES) % num_of_slices) * batch_size;
+
+      // Alternate which variant runs first so that neither one always finds the batch already in the cache
+      int64_t pool_ns = 0;
+      int64_t spawn_ns = 0;
+      for (int run = 0; run < 2; run++)
+      {
+        auto run_start_time = high_resolution_clock::now();
+        if ((run == 0) == (i % 2 == 0))
+        {
+          parallel = pool.partition(batch, batch_size);
+          pool_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - run_start_time).count();
+          if (debug && i == 0)
+          {
+            verified = verified && verify_output(pool.output(), pool.bucket_start(), batch, batch_size);
+          }
+        }
+        else
+        {
+          spawn_partition(batch, batch_size, num_of_threads, num_of_buckets, spawn_output, spawn_bucket_start);
+          spawn_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - run_start_time).count();
+          if (debug && i == 0)
+          {
+            verified = verified && verify_output(spawn_output.data(), spawn_bucket_start, batch, batch_size);
+          }
+        }
+      }
+
+      if (i >= 0)
+      {
+        pool_latencies.record(pool_ns);
+        spawn_latencies.record(spawn_ns);
+        pool_total_ns += pool_ns;
+        spawn_total_ns += spawn_ns;
+      }
+    }
+
+    print_latencies(parallel ? "pool, all threads," : "pool, calling thread,", batch_size, pool_latencies, pool_total_ns);
+    print_latencies("spawn per batch,", batch_size, spawn_latencies, spawn_total_ns);
+
+    // Append metrics to CSV file using the provided filename
+    append_metrics_to_csv(filename, PROGRAM_NAME + "-" + to_string(batch_size), num_of_threads, num_of_hashbits, num_of_buckets, data_size, pool_total_ns / 1e6, thread::hardware_concurrency(), memory_used);
+    append_metrics_to_csv(filename, SPAWN_PROGRAM_NAME + "-" + to_string(batch_size), num_of_threads, num_of_hashbits, num_of_buckets, data_size, spawn_total_ns / 1e6, thread::hardware_concurrency(), memory_used);
+  }
+
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  cout << "Total time: " << duration.count() << " ms" << endl;
+
+  if (debug)
+  {
+    cout << "Output verified: " << (verified ? "yes" : "NO") << endl;
+  }
+
+  return 0;
+}
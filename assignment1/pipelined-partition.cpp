@@ -0,0 +1,729 @@
+/**
+ * This program runs generation, partitioning and consumption as a pipeline instead of one phase after the other.
+ * Producer threads generate batches of tuples and push them into a bounded lock-free queue, partitioner threads pull
+ * the batches and scatter them into per-thread partition blocks, and full blocks are pushed into a second queue that
+ * consumer threads drain. The end-to-end latency of every batch (generated until all of its tuples are consumed) and
+ * the steady-state throughput of the pipeline are reported.
+ * @param num_of_threads The number of partitioner threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param batch_size (optional) The number of tuples in every batch. Defaults to 4096.
+ * @param num_of_producers (optional) The number of producer threads. Defaults to 1.
+ * @param num_of_consumers (optional) The number of consumer threads. Defaults to 1.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <tuple>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "pipelined";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// Number of batches that can be in flight between the producers and the partitioners
+const int BATCH_QUEUE_CAPACITY = 256;
+
+// Number of finished partition blocks that can wait for the consumers
+const int BLOCK_QUEUE_CAPACITY = 1 << 16;
+
+// Number of tuples every partitioner may hold in partially filled blocks
+const int PARTITIONER_BUFFER_TUPLES = 1 << 20;
+
+/**
+ * A bounded lock-free multi-producer multi-consumer queue (Dmitry Vyukov's design).
+ * Every cell carries a sequence number telling whether it is ready to be written or read in the current lap,
+ * so producers and consumers only contend on their own position counter.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+  /**
+   * Create a queue.
+   * @param capacity The capacity of the queue. Rounded up to a power of two.
+   */
+  explicit BoundedQueue(size_t capacity) : enqueue_pos(0), dequeue_pos(0)
+  {
+    size_t size = 1;
+    while (size < capacity)
+    {
+      size <<= 1;
+    }
+    mask = size - 1;
+    cells.reset(new Cell[size]);
+    for (size_t i = 0; i < size; i++)
+    {
+      cells[i].sequence.store(i, memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Try to push a value.
+   * @param value The value to push.
+   * @return Whether the value was pushed, false if the queue is full.
+   */
+  bool push(const T &value)
+  {
+    size_t pos = enqueue_pos.load(memory_order_relaxed);
+    for (;;)
+    {
+      Cell &cell = cells[pos & mask];
+      size_t sequence = cell.sequence.load(memory_order_acquire);
+      intptr_t difference = (intptr_t)sequence - (intptr_t)pos;
+      if (difference == 0)
+      {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+        {
+          cell.value = value;
+          cell.sequence.store(pos + 1, memory_order_release);
+          return true;
+        }
+      }
+      else if (difference < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = enqueue_pos.load(memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Try to pop a value.
+   * @param value The popped value.
+   * @return Whether a value was popped, false if the queue is empty.
+   */
+  bool pop(T &value)
+  {
+    size_t pos = dequeue_pos.load(memory_order_relaxed);
+    for (;;)
+    {
+      Cell &cell = cells[pos & mask];
+      size_t sequence = cell.sequence.load(memory_order_acquire);
+      intptr_t difference = (intptr_t)sequence - (intptr_t)(pos + 1);
+      if (difference == 0)
+      {
+        if (dequeue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+        {
+          value = cell.value;
+          cell.sequence.store(pos + mask + 1, memory_order_release);
+          return true;
+        }
+      }
+      else if (difference < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = dequeue_pos.load(memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  struct Cell
+  {
+    atomic<size_t> sequence;
+    T value;
+  };
+
+  unique_ptr<Cell[]> cells;
+  size_t mask;
+  // Keep the two positions on separate cache lines so producers and consumers do not false share
+  alignas(64) atomic<size_t> enqueue_pos;
+  alignas(64) atomic<size_t> dequeue_pos;
+};
+
+/**
+ * A batch of generated tuples.
+ */
+struct Batch
+{
+  int id;
+  vector<tuple<int64_t, int64_t>> tuples;
+};
+
+/**
+ * A block of tuples that all belong to the same partition. The batches the tuples came from are recorded as runs of
+ * (batch id, number of tuples) so the consumers can tell when a batch has been consumed completely.
+ */
+struct PartitionBlock
+{
+  int bucket;
+  int size;
+  vector<tuple<int64_t, int64_t>> tuples;
+  vector<pair<int, int>> batch_runs;
+};
+
+/**
+ * The state shared by all stages of the pipeline.
+ */
+struct Pipeline
+{
+  Pipeline(int num_of_batches)
+      : full_batches(BATCH_QUEUE_CAPACITY), free_batches(BATCH_QUEUE_CAPACITY), full_blocks(BLOCK_QUEUE_CAPACITY),
+        free_blocks(BLOCK_QUEUE_CAPACITY), next_batch(0), producers_running(0), partitioners_running(0),
+        created_ns(num_of_batches), remaining(num_of_batches)
+  {
+  }
+
+  BoundedQueue<Batch *> full_batches;
+  BoundedQueue<Batch *> free_batches;
+  BoundedQueue<PartitionBlock *> full_blocks;
+  BoundedQueue<PartitionBlock *> free_blocks;
+  atomic<int> next_batch;
+  atomic<int> producers_running;
+  atomic<int> partitioners_running;
+  // Creation time of every batch and the number of its tuples not consumed yet
+  vector<int64_t> created_ns;
+  vector<atomic<int>> remaining;
+};
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Get the current time in nanoseconds on a monotonic clock.
+ * @return The current time.
+ */
+int64_t now_ns()
+{
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Compute the number of tuples in a partition block. With many buckets the blocks shrink so that every partitioner
+ * keeps PARTITIONER_BUFFER_TUPLES tuples at most, but a block is never smaller than a cache line.
+ * @param num_of_buckets The number of buckets.
+ * @return The number of tuples in a block.
+ */
+int compute_block_size(int num_of_buckets)
+{
+  return max(4, min(256, PARTITIONER_BUFFER_TUPLES / num_of_buckets));
+}
+
+/**
+ * Generate batches of tuples and push them to the partitioners.
+ * Batch ids are handed out from a shared counter so any number of producers can run.
+ * @param pipeline The pipeline.
+ * @param thread_id The id of the thread.
+ * @param data_size The size of the data to generate.
+ * @param batch_size The number of tuples in every batch.
+ */
+void produce_batches(Pipeline &pipeline, int thread_id, int data_size, int batch_size)
+{
+  pin_thread(thread_id);
+  int num_of_batches = (data_size + batch_size - 1) / batch_size;
+
+  for (int id = pipeline.next_batch++; id < num_of_batches; id = pipeline.next_batch++)
+  {
+    Batch *batch;
+    if (!pipeline.free_batches.pop(batch))
+    {
+      batch = new Batch();
+    }
+
+    int start = id * batch_size;
+    int end = min(data_size, start + batch_size);
+    batch->id = id;
+    batch->tuples.resize(end - start);
+    for (int64_t i = start; i < end; i++)
+    {
+      batch->tuples[i - start] = tuple<int64_t, int64_t>(i + 1, i + 1);
+    }
+
+    pipeline.remaining[id] = end - start;
+    pipeline.created_ns[id] = now_ns();
+    // Back-pressure: wait for the partitioners when the queue is full
+    while (!pipeline.full_batches.push(batch))
+    {
+      this_thread::yield();
+    }
+  }
+  pipeline.producers_running--;
+}
+
+/**
+ * Hand a partition block over to the consumers and replace it with an empty one.
+ * @param pipeline The pipeline.
+ * @param block The block to hand over. Replaced by an empty block.
+ * @param block_size The number of tuples in a block.
+ */
+void emit_block(Pipeline &pipeline, PartitionBlock *&block, int block_size)
+{
+  int bucket = block->bucket;
+  while (!pipeline.full_blocks.push(block))
+  {
+    this_thread::yield();
+  }
+  if (!pipeline.free_blocks.pop(block))
+  {
+    block = new PartitionBlock();
+    block->tuples.resize(block_size);
+  }
+  block->bucket = bucket;
+  block->size = 0;
+  block->batch_runs.clear();
+}
+
+/**
+ * Pull batches and scatter them into partition blocks. Full blocks are handed to the consumers right away and
+ * partially filled blocks are handed over whenever the partitioner runs out of input, so a slow producer does not
+ * hold back the batches that are already partitioned.
+ * @param pipeline The pipeline.
+ * @param thread_id The id of the thread.
+ * @param num_of_buckets The number of buckets.
+ */
+void partition_batches(Pipeline &pipeline, int thread_id, int num_of_buckets)
+{
+  pin_thread(thread_id);
+  int block_size = compute_block_size(num_of_buckets);
+  vector<PartitionBlock *> blocks(num_of_buckets);
+  for (int i = 0; i < num_of_buckets; i++)
+  {
+    blocks[i] = new PartitionBlock();
+    blocks[i]->bucket = i;
+    blocks[i]->size = 0;
+    blocks[i]->tuples.resize(block_size);
+  }
+
+  auto flush_partial_blocks = [&]() {
+    for (int i = 0; i < num_of_buckets; i++)
+    {
+      if (blocks[i]->size > 0)
+      {
+        emit_block(pipeline, blocks[i], block_size);
+      }
+    }
+  };
+
+  bool has_partial_blocks = false;
+  for (;;)
+  {
+    Batch *batch;
+    if (!pipeline.full_batches.pop(batch))
+    {
+      if (has_partial_blocks)
+      {
+        flush_partial_blocks();
+        has_partial_blocks = false;
+      }
+      if (pipeline.producers_running > 0)
+      {
+        this_thread::yield();
+        continue;
+      }
+      // The producers are done, so anything still in the queue was pushed before they finished
+      if (!pipeline.full_batches.pop(batch))
+      {
+        break;
+      }
+    }
+
+    for (const tuple<int64_t, int64_t> &item : batch->tuples)
+    {
+      PartitionBlock *block = blocks[get_partition(get<0>(item), num_of_buckets)];
+      if (block->batch_runs.empty() || block->batch_runs.back().first != batch->id)
+      {
+        block->batch_runs.push_back(make_pair(batch->id, 0));
+      }
+      block->batch_runs.back().second++;
+      block->tuples[block->size++] = item;
+      if (block->size == block_size)
+      {
+        emit_block(pipeline, blocks[block->bucket], block_size);
+      }
+    }
+    has_partial_blocks = true;
+
+    if (!pipeline.free_batches.push(batch))
+    {
+      delete batch;
+    }
+  }
+
+  for (PartitionBlock *block : blocks)
+  {
+    delete block;
+  }
+  pipeline.partitioners_running--;
+}
+
+/**
+ * Drain finished partition blocks. Every block is consumed by summing its payloads per bucket, and a batch is
+ * complete once all of its tuples have been consumed, which is when its end-to-end latency is recorded.
+ * @param pipeline The pipeline.
+ * @param thread_id The id of the thread.
+ * @param num_of_buckets The number of buckets.
+ * @param bucket_sizes The number of tuples this consumer saw per bucket.
+ * @param misplaced The number of tuples this consumer found in the wrong bucket.
+ * @param latencies_ns The end-to-end latencies of the batches completed by this consumer.
+ * @param consumed_ns The times at which this consumer consumed a block, with the number of tuples in it.
+ */
+void consume_blocks(Pipeline &pipeline, int thread_id, int num_of_buckets, vector<int> &bucket_sizes, long &misplaced,
+             vector<int64_t> &latencies_ns, vector<pair<int64_t, int>> &consumed_ns)
+{
+  pin_thread(thread_id);
+  vector<int64_t> bucket_sums(num_of_buckets, 0);
+
+  for (;;)
+  {
+    PartitionBlock *block;
+    if (!pipeline.full_blocks.pop(block))
+    {
+      if (pipeline.partitioners_running > 0)
+      {
+        this_thread::yield();
+        continue;
+      }
+      if (!pipeline.full_blocks.pop(block))
+      {
+        break;
+      }
+    }
+
+    for (int j = 0; j < block->size; j++)
+    {
+      bucket_sums[block->bucket] += get<1>(block->tuples[j]);
+      misplaced += get_partition(get<0>(block->tuples[j]), num_of_buckets) != block->bucket;
+    }
+    bucket_sizes[block->bucket] += block->size;
+
+    int64_t now = now_ns();
+    for (const pair<int, int> &run : block->batch_runs)
+    {
+      if ((pipeline.remaining[run.first] -= run.second) == 0)
+      {
+        latencies_ns.push_back(now - pipeline.created_ns[run.first]);
+      }
+    }
+    consumed_ns.push_back(make_pair(now, block->size));
+
+    if (!pipeline.free_blocks.push(block))
+    {
+      delete block;
+    }
+  }
+}
+
+/**
+ * Compute the throughput in the steady state of the pipeline, leaving out the first and the last 10% of the tuples
+ * so that filling and draining the pipeline does not count.
+ * @param consumed_ns The times at which blocks were consumed, with the number of tuples in them.
+ * @param data_size The size of the data.
+ * @return The steady-state throughput in millions of tuples per second.
+ */
+double compute_steady_state_throughput(vector<pair<int64_t, int>> consumed_ns, int data_size)
+{
+  sort(consumed_ns.begin(), consumed_ns.end());
+  long low = data_size / 10;
+  long high = data_size - data_size / 10;
+  long consumed = 0;
+  int64_t start_ns = 0;
+  int64_t end_ns = 0;
+  long start_consumed = 0;
+  long end_consumed = 0;
+  for (const pair<int64_t, int> &entry : consumed_ns)
+  {
+    consumed += entry.second;
+    if (start_ns == 0 && consumed >= low)
+    {
+      start_ns = entry.first;
+      start_consumed = consumed;
+    }
+    if (consumed <= high)
+    {
+      end_ns = entry.first;
+      end_consumed = consumed;
+    }
+    else
+    {
+      break;
+    }
+  }
+  if (end_ns <= start_ns)
+  {
+    return 0;
+  }
+  return double(end_consumed - start_consumed) / (end_ns - start_ns) * 1e3;
+}
+
+/**
+ * Get a percentile of a sorted list of values.
+ * @param sorted The sorted values.
+ * @param percentile The percentile to get, between 0 and 100.
+ * @return The percentile.
+ */
+int64_t get_percentile(const vector<int64_t> &sorted, double percentile)
+{
+  if (sorted.empty())
+  {
+    return 0;
+  }
+  size_t index = min(sorted.size() - 1, (size_t)(percentile / 100 * sorted.size()));
+  return sorted[index];
+}
+
+/**
+ * Print the batch latencies.
+ * @param latencies_ns The latencies of all batches, sorted.
+ */
+void print_latencies(const vector<int64_t> &latencies_ns)
+{
+  cout << fixed << setprecision(3);
+  cout << "Batch latency (ms): p50 " << get_percentile(latencies_ns, 50) / 1e6
+       << ", p99 " << get_percentile(latencies_ns, 99) / 1e6
+       << ", max " << (latencies_ns.empty() ? 0 : latencies_ns.back()) / 1e6 << endl;
+  cout.unsetf(ios_base::floatfield);
+}
+
+/**
+ * Print the number of tuples in every partition.
+ * @param bucket_sizes The number of tuples per bucket.
+ * @param misplaced The number of tuples found in the wrong bucket.
+ */
+void print_output(const vector<int> &bucket_sizes, long misplaced)
+{
+  cout << "Partition sizes: ";
+  for (int i = 0; i < min(16, (int)bucket_sizes.size()); i++)
+  {
+    cout << bucket_sizes[i] << " ";
+  }
+  cout << (bucket_sizes.size() > 16 ? "..." : "") << endl;
+  cout << "Misplaced tuples: " << misplaced << endl;
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [batch_size] [num_of_producers] [num_of_consumers]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 4096 2 2" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param batch_size The number of tuples in every batch.
+ * @param num_of_producers The number of producer threads.
+ * @param num_of_consumers The number of consumer threads.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  int batch_size, int num_of_producers, int num_of_consumers)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tBatch size: " << batch_size << endl;
+  cout << "\tProducers / consumers: " << num_of_producers << " / " << num_of_consumers << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << PROGRAM_NAME << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc < 6 || argc > 9)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  int batch_size = argc > 6 ? stoi(argv[6]) : 4096;
+  int num_of_producers = argc > 7 ? stoi(argv[7]) : 1;
+  int num_of_consumers = argc > 8 ? stoi(argv[8]) : 1;
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+  if (batch_size <= 0 || num_of_threads <= 0 || num_of_producers <= 0 || num_of_consumers <= 0)
+  {
+    cerr << "Error: Batch size and thread counts must be positive" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug,
+               batch_size, num_of_producers, num_of_consumers);
+
+  int num_of_batches = (data_size + batch_size - 1) / batch_size;
+  Pipeline pipeline(num_of_batches);
+  pipeline.producers_running = num_of_producers;
+  pipeline.partitioners_running = num_of_threads;
+
+  vector<vector<int>> bucket_sizes(num_of_consumers, vector<int>(num_of_buckets, 0));
+  vector<long> misplaced(num_of_consumers, 0);
+  vector<vector<int64_t>> latencies_ns(num_of_consumers);
+  vector<vector<pair<int64_t, int>>> consumed_ns(num_of_consumers);
+
+  auto start_time = high_resolution_clock::now();
+
+  // Every stage gets its own range of cores, starting with the partitioners
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    threads.push_back(thread(partition_batches, ref(pipeline), i, num_of_buckets));
+  }
+  for (int i = 0; i < num_of_consumers; i++)
+  {
+    threads.push_back(thread(consume_blocks, ref(pipeline), num_of_threads + i, num_of_buckets, ref(bucket_sizes[i]),
+                             ref(misplaced[i]), ref(latencies_ns[i]), ref(consumed_ns[i])));
+  }
+  for (int i = 0; i < num_of_producers; i++)
+  {
+    threads.push_back(thread(produce_batches, ref(pipeline), num_of_threads + num_of_consumers + i, data_size, batch_size));
+  }
+
+  // Wait for all threads to complete
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  auto end_time = high_resolution_clock::now();
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  // Release the recycled batches and blocks
+  Batch *batch;
+  while (pipeline.free_batches.pop(batch))
+  {
+    delete batch;
+  }
+  PartitionBlock *block;
+  while (pipeline.free_blocks.pop(block))
+  {
+    delete block;
+  }
+
+  // Merge what every consumer collected
+  vector<int64_t> all_latencies_ns;
+  vector<pair<int64_t, int>> all_consumed_ns;
+  vector<int> all_bucket_sizes(num_of_buckets, 0);
+  long all_misplaced = 0;
+  for (int i = 0; i < num_of_consumers; i++)
+  {
+    all_latencies_ns.insert(all_latencies_ns.end(), latencies_ns[i].begin(), latencies_ns[i].end());
+    all_consumed_ns.insert(all_consumed_ns.end(), consumed_ns[i].begin(), consumed_ns[i].end());
+    for (int j = 0; j < num_of_buckets; j++)
+    {
+      all_bucket_sizes[j] += bucket_sizes[i][j];
+    }
+    all_misplaced += misplaced[i];
+  }
+  sort(all_latencies_ns.begin(), all_latencies_ns.end());
+
+  cout << "Processing time: " << duration.count() << " ms" << endl;
+  cout << "Completed batches: " << all_latencies_ns.size() << " of " << num_of_batches << endl;
+  print_latencies(all_latencies_ns);
+  cout << fixed << setprecision(2);
+  cout << "Steady-state throughput: " << compute_steady_state_throughput(all_consumed_ns, data_size) << " MT/s" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    print_output(all_bucket_sizes, all_misplaced);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
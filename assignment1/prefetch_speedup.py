@@ -0,0 +1,64 @@
+import pandas as pd
+import matplotlib.pyplot as plt
+import matplotlib as mpl
+import numpy as np
+
+# Set modern style
+mpl.style.use('seaborn-v0_8')
+
+# Load CSV files
+metrics_df = pd.read_csv("metrics.csv")
+
+# Split the algorithm name into the base algorithm and the prefetch distance (0 = no prefetching)
+split = metrics_df['algorithm'].str.extract(r'^(.*?)(?:-prefetch-(\d+))?$')
+metrics_df['base'] = split[0]
+metrics_df['distance'] = split[1].fillna(0).astype(int)
+
+algorithms = ['count-then-move', 'concurrent-output']
+metrics_df = metrics_df[metrics_df['base'].isin(algorithms)]
+mean_df = metrics_df.groupby(['base', 'distance', 'threads', 'hashbits'], as_index=False)['duration'].mean()
+
+# Speedup of every prefetch distance over the same algorithm without prefetching
+baseline_df = mean_df[mean_df['distance'] == 0][['base', 'threads', 'hashbits', 'duration']]
+speedup_df = mean_df[mean_df['distance'] > 0].merge(baseline_df, on=['base', 'threads', 'hashbits'],
+                                                    suffixes=('', '_baseline'))
+speedup_df['speedup'] = speedup_df['duration_baseline'] / speedup_df['duration']
+
+if speedup_df.empty:
+    print("No prefetching runs with a matching baseline found in metrics.csv")
+    raise SystemExit(0)
+
+# Print the speedup per hash bit using the largest thread count of the sweep
+max_threads = speedup_df['threads'].max()
+for algorithm in algorithms:
+    table = speedup_df[(speedup_df['base'] == algorithm) & (speedup_df['threads'] == max_threads)].pivot(
+        index='hashbits', columns='distance', values='speedup')
+    if not table.empty:
+        print(f"{algorithm} speedup over no prefetching with {max_threads} threads (columns: prefetch distance)")
+        print(table.round(2).to_string())
+        print()
+
+# Create subplots
+fig, axes = plt.subplots(1, 2, figsize=(14, 6), sharey=True)
+distances = sorted(speedup_df['distance'].unique())
+colors = plt.cm.viridis_r(np.linspace(0, 1, len(distances)))
+
+for ax, label, algorithm in zip(axes, ['(a)', '(b)'], algorithms):
+    for i, distance in enumerate(distances):
+        subset = speedup_df[(speedup_df['base'] == algorithm) & (speedup_df['distance'] == distance) &
+                            (speedup_df['threads'] == max_threads)]
+        ax.plot(subset['hashbits'], subset['speedup'], marker='o', color=colors[i], label=f'distance {distance}')
+    ax.axhline(1.0, color='gray', linestyle='--')
+    ax.set_title(f'{label} {algorithm.capitalize()}', fontsize=15)
+    ax.set_xlabel('Hash Bits', fontsize=15)
+    ax.grid(True, linestyle='--', alpha=0.7)
+    ax.set_xticks(range(1, max(metrics_df['hashbits']) + 1))
+axes[0].set_ylabel(f'Speedup with {max_threads} threads', fontsize=15)
+
+# Common legend
+handles, labels = axes[0].get_legend_handles_labels()
+fig.legend(handles, labels, loc='upper center', ncol=min(7, len(handles)), bbox_to_anchor=(0.5, 1.05))
+
+plt.tight_layout()
+plt.savefig("prefetch_speedup.png", bbox_inches='tight')
+plt.show()
@@ -0,0 +1,596 @@
+/**
+ * This program partitions the data by key range instead of by hash, so the partitions keep the order of the keys.
+ * The splitters are chosen from a sample that every thread takes of its chunk in parallel, and they are stored in
+ * Eytzinger (breadth-first) order so that finding the partition of a key is a fixed number of branch-free steps down
+ * a cache-resident tree. Groups of keys walk the tree in lockstep so their loads overlap.
+ * For comparison the same data is also hash partitioned at the same fan-out with the same two-pass
+ * count-then-scatter, and the time of both is reported.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used, i.e. log2 of the number of range partitions.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param shuffle (optional) 1 to shuffle the data before partitioning, since the generated keys are sorted.
+ *        Defaults to 0.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "range-partition";
+
+// Name the hash partitioning at the same fan-out is recorded under in the CSV file
+const string HASH_PROGRAM_NAME = "hash-partition";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// Number of keys sampled per partition when choosing the splitters
+const int SAMPLES_PER_PARTITION = 128;
+
+// Number of keys that walk the splitter tree in lockstep
+const int SEARCH_GROUP_SIZE = 8;
+
+/**
+ * The splitters of a range partitioning in Eytzinger order. tree[1] is the median splitter and the children of
+ * tree[i] are tree[2i] and tree[2i + 1]. tree[0] is unused.
+ */
+struct SplitterTree
+{
+  vector<int64_t> tree;
+  int levels;
+};
+
+/**
+ * Get the data given a number.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Get the range partition for a number. Every level of the tree is one comparison whose result is added to the
+ * index, so there are no branches that depend on the key.
+ * @param n The number to get the partition for.
+ * @param splitters The splitter tree.
+ * @return The number of splitters smaller than or equal to n, which is the partition for the number.
+ */
+int get_range_partition(int64_t n, const SplitterTree &splitters)
+{
+  const int64_t *tree = splitters.tree.data();
+  int i = 1;
+  for (int level = 0; level < splitters.levels; level++)
+  {
+    i = 2 * i + (n >= tree[i]);
+  }
+  return i - (1 << splitters.levels);
+}
+
+/**
+ * Get the range partitions for a group of numbers. The numbers walk down the tree level by level together, so the
+ * loads of the group are independent of each other and can be in flight at the same time.
+ * @param items The tuples whose keys to get the partitions for.
+ * @param splitters The splitter tree.
+ * @param partitions The partitions of the group.
+ */
+void get_range_partitions(const tuple<int64_t, int64_t> *items, const SplitterTree &splitters, int *partitions)
+{
+  const int64_t *tree = splitters.tree.data();
+  int64_t keys[SEARCH_GROUP_SIZE];
+  int index[SEARCH_GROUP_SIZE];
+  for (int k = 0; k < SEARCH_GROUP_SIZE; k++)
+  {
+    keys[k] = get<0>(items[k]);
+    index[k] = 1;
+  }
+  for (int level = 0; level < splitters.levels; level++)
+  {
+    for (int k = 0; k < SEARCH_GROUP_SIZE; k++)
+    {
+      index[k] = 2 * index[k] + (keys[k] >= tree[index[k]]);
+    }
+  }
+  for (int k = 0; k < SEARCH_GROUP_SIZE; k++)
+  {
+    partitions[k] = index[k] - (1 << splitters.levels);
+  }
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Sample random keys of a chunk.
+ * @param thread_id The id of the thread, also used as the seed so runs are reproducible.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to sample.
+ * @param sample The sample to write the keys to.
+ */
+void sample_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data,
+                  vector<int64_t> &sample)
+{
+  pin_thread(thread_id);
+  if (end <= start)
+  {
+    sample.clear();
+    return;
+  }
+  mt19937 generator(thread_id + 1);
+  uniform_int_distribution<int> index(start, end - 1);
+  for (size_t s = 0; s < sample.size(); s++)
+  {
+    sample[s] = get<0>(data[index(generator)]);
+  }
+}
+
+/**
+ * Fill the Eytzinger tree with the splitters in sorted order by an in-order walk.
+ * @param sorted The splitters in sorted order.
+ * @param next The index of the next splitter to place.
+ * @param tree The tree to fill.
+ * @param i The node to fill.
+ */
+void fill_eytzinger(const vector<int64_t> &sorted, int &next, vector<int64_t> &tree, int i)
+{
+  if (i >= (int)tree.size())
+  {
+    return;
+  }
+  fill_eytzinger(sorted, next, tree, 2 * i);
+  tree[i] = sorted[next++];
+  fill_eytzinger(sorted, next, tree, 2 * i + 1);
+}
+
+/**
+ * Choose the splitters from a parallel sample of the keys.
+ * @param data The data to choose the splitters for.
+ * @param num_of_threads The number of threads to use.
+ * @param num_of_hashbits The number of partitions as a number of bits.
+ * @return The splitter tree.
+ */
+SplitterTree choose_splitters(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads, int num_of_hashbits)
+{
+  int data_size = data.size();
+  int num_of_buckets = 1 << num_of_hashbits;
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  // Sampling more than a quarter of the data does not make the splitters any better than sorting would
+  int64_t sample_size = min((int64_t)num_of_buckets * SAMPLES_PER_PARTITION, max((int64_t)num_of_buckets, (int64_t)data_size / 4));
+
+  vector<vector<int64_t>> samples(num_of_threads);
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    samples[i].resize(sample_size * (end - start) / max(1, data_size) + 1);
+    threads.push_back(thread(sample_chunk, i, start, end, ref(data), ref(samples[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  vector<int64_t> sample;
+  for (const vector<int64_t> &chunk_sample : samples)
+  {
+    sample.insert(sample.end(), chunk_sample.begin(), chunk_sample.end());
+  }
+  sort(sample.begin(), sample.end());
+
+  // Splitter j is the lower bound of partition j + 1
+  vector<int64_t> sorted(num_of_buckets - 1);
+  for (int j = 0; j < num_of_buckets - 1; j++)
+  {
+    sorted[j] = sample.empty() ? 0 : sample[(int64_t)(j + 1) * sample.size() / num_of_buckets];
+  }
+
+  SplitterTree splitters;
+  splitters.levels = num_of_hashbits;
+  splitters.tree.assign(num_of_buckets, 0);
+  int next = 0;
+  fill_eytzinger(sorted, next, splitters.tree, 1);
+  return splitters;
+}
+
+/**
+ * Compute the range partition of every tuple of a chunk and count them.
+ * The partitions are kept so the scatter does not have to search the tree again.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param splitters The splitter tree.
+ * @param partitions The partition of every tuple.
+ * @param histogram The histogram of the thread.
+ */
+void count_range_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data,
+                       const SplitterTree &splitters, vector<int> &partitions, vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  int j = start;
+  for (; j + SEARCH_GROUP_SIZE <= end; j += SEARCH_GROUP_SIZE)
+  {
+    get_range_partitions(&data[j], splitters, &partitions[j]);
+    for (int k = 0; k < SEARCH_GROUP_SIZE; k++)
+    {
+      histogram[partitions[j + k]]++;
+    }
+  }
+  for (; j < end; j++)
+  {
+    partitions[j] = get_range_partition(get<0>(data[j]), splitters);
+    histogram[partitions[j]]++;
+  }
+}
+
+/**
+ * Compute the hash partition of every tuple of a chunk and count them.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_buckets The number of buckets.
+ * @param partitions The partition of every tuple.
+ * @param histogram The histogram of the thread.
+ */
+void count_hash_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data,
+                      int num_of_buckets, vector<int> &partitions, vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    partitions[j] = get_partition(get<0>(data[j]), num_of_buckets);
+    histogram[partitions[j]]++;
+  }
+}
+
+/**
+ * Scatter a chunk of data to the partitions computed by the count pass.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param partitions The partition of every tuple.
+ * @param offsets The write offsets of the thread.
+ * @param output The output to scatter to.
+ */
+void scatter_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data,
+                   const vector<int> &partitions, vector<int> &offsets, vector<tuple<int64_t, int64_t>> &output)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    output[offsets[partitions[j]]++] = data[j];
+  }
+}
+
+/**
+ * Partition the data with a two-pass count-then-scatter, using range or hash partitioning.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads to use.
+ * @param num_of_buckets The number of buckets.
+ * @param splitters The splitter tree for range partitioning, or nullptr for hash partitioning.
+ * @param output The partitioned data, bucket by bucket.
+ * @param bucket_start The start of every bucket in the output, followed by the data size.
+ */
+void run_partitioning(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads, int num_of_buckets,
+                      const SplitterTree *splitters, vector<tuple<int64_t, int64_t>> &output, vector<int> &bucket_start)
+{
+  int data_size = data.size();
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+  vector<int> partitions(data_size);
+
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    if (splitters)
+    {
+      threads.push_back(thread(count_range_chunk, i, start, end, ref(data), cref(*splitters), ref(partitions),
+                               ref(histograms[i])));
+    }
+    else
+    {
+      threads.push_back(thread(count_hash_chunk, i, start, end, ref(data), num_of_buckets, ref(partitions),
+                               ref(histograms[i])));
+    }
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  bucket_start.assign(num_of_buckets + 1, 0);
+  int offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    bucket_start[b] = offset;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+  }
+  bucket_start[num_of_buckets] = offset;
+
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk, i, start, end, ref(data), cref(partitions), ref(histograms[i]),
+                             ref(output)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+}
+
+/**
+ * Check that the range partitions are in key order and that no tuple was lost.
+ * @param output The partitioned data.
+ * @param bucket_start The start of every bucket in the output, followed by the data size.
+ * @param num_of_buckets The number of buckets.
+ * @param data_size The size of the data.
+ * @return Whether the partitioning is correct.
+ */
+bool verify_output(const vector<tuple<int64_t, int64_t>> &output, const vector<int> &bucket_start, int num_of_buckets,
+                   int data_size)
+{
+  int64_t previous_max = INT64_MIN;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    int64_t bucket_max = previous_max;
+    for (int j = bucket_start[b]; j < bucket_start[b + 1]; j++)
+    {
+      if (get<0>(output[j]) < previous_max)
+      {
+        return false;
+      }
+      bucket_max = max(bucket_max, get<0>(output[j]));
+    }
+    previous_max = bucket_max;
+  }
+  return bucket_start[num_of_buckets] == data_size;
+}
+
+/**
+ * Print the balance of the partitions, i.e. how much larger the largest partition is than the average.
+ * @param bucket_start The start of every bucket in the output, followed by the data size.
+ * @param num_of_buckets The number of buckets.
+ */
+void print_balance(const vector<int> &bucket_start, int num_of_buckets)
+{
+  int largest = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    largest = max(largest, bucket_start[b + 1] - bucket_start[b]);
+  }
+  double average = (double)bucket_start[num_of_buckets] / num_of_buckets;
+  cout << fixed << setprecision(2);
+  cout << "Largest range partition: " << largest << " tuples (" << (average > 0 ? largest / average : 0)
+       << "x the average)" << endl;
+  cout.unsetf(ios_base::floatfield);
+}
+
+/**
+ * Print the output vector.
+ * @param output The partitioned data.
+ * @param bucket_start The start of every bucket in the output, followed by the data size.
+ * @param num_of_buckets The number of buckets to use.
+ */
+void print_output(const vector<tuple<int64_t, int64_t>> &output, const vector<int> &bucket_start, int num_of_buckets)
+{
+  cout << "Data (first 10 elements from each partition): " << endl;
+  for (int b = 0; b < min(num_of_buckets, 16); b++)
+  {
+    cout << "Partition " << b << " (size: " << bucket_start[b + 1] - bucket_start[b] << "): ";
+    for (int j = bucket_start[b]; j < min(bucket_start[b] + 10, bucket_start[b + 1]); j++)
+    {
+      cout << "(" << get<0>(output[j]) << "," << get<1>(output[j]) << ") ";
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [shuffle]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 1" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param shuffle Whether the data is shuffled.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  bool shuffle)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tShuffle: " << shuffle << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record the metrics under.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc != 6 && argc != 7)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  bool shuffle_data = argc == 7 && stoi(argv[6]);
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, shuffle_data);
+
+  auto data = get_data_given_n(data_size);
+  if (shuffle_data)
+  {
+    shuffle(data.begin(), data.end(), mt19937(42));
+  }
+
+  vector<tuple<int64_t, int64_t>> output(data_size);
+  vector<int> bucket_start;
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+  SplitterTree splitters = choose_splitters(data, num_of_threads, num_of_hashbits);
+  auto splitters_time = high_resolution_clock::now();
+  run_partitioning(data, num_of_threads, num_of_buckets, &splitters, output, bucket_start);
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  if (debug)
+  {
+    cout << "Output verified: " << (verify_output(output, bucket_start, num_of_buckets, data_size) ? "yes" : "NO") << endl;
+    print_output(output, bucket_start, num_of_buckets);
+  }
+  print_balance(bucket_start, num_of_buckets);
+
+  vector<tuple<int64_t, int64_t>> hash_output(data_size);
+  vector<int> hash_bucket_start;
+  auto hash_start_time = high_resolution_clock::now();
+  run_partitioning(data, num_of_threads, num_of_buckets, nullptr, hash_output, hash_bucket_start);
+  auto hash_end_time = high_resolution_clock::now();
+  auto hash_duration = duration_cast<milliseconds>(hash_end_time - hash_start_time);
+
+  cout << fixed << setprecision(2);
+  cout << "Range: " << chrono::duration<double, milli>(end_time - start_time).count() << " ms (splitters "
+       << chrono::duration<double, milli>(splitters_time - start_time).count() << " ms)" << endl;
+  cout << "Hash: " << chrono::duration<double, milli>(hash_end_time - hash_start_time).count() << " ms" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+  append_metrics_to_csv(filename, HASH_PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, hash_duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
@@ -0,0 +1,756 @@
+/**
+ * This program reports how close a partitioning run comes to the memory bandwidth of the machine.
+ * At startup a STREAM-like probe measures the bandwidth of sequential reads, sequential writes, non-temporal writes and
+ * writes of whole cache lines in random order at several thread counts (or loads them from a file saved by an earlier
+ * run). The data is then partitioned with a count pass and a scatter pass. Each pass is reported as a percentage of
+ * its ceiling: the read bandwidth for the count pass, and for the scatter pass sequential writes while one cache line
+ * per bucket fits into the L1 cache and random cache-line writes beyond that.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param roofline_file (optional) The file to load the probe results from. It is written if it does not exist.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <tuple>
+#include <string>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <unistd.h>
+#include <sys/sysinfo.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "roofline-partition";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// Smallest and largest buffer used by the probe. It should be well beyond the last level cache.
+const size_t MIN_PROBE_BYTES = size_t(1) << 28;
+const size_t MAX_PROBE_BYTES = size_t(1) << 30;
+
+// Number of 64-bit words in a cache line
+const int WORDS_PER_CACHE_LINE = 8;
+
+// Odd multipliers of the permutation that visits the cache lines of a power-of-two sized buffer in a random order
+const uint64_t RANDOM_LINE_MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+const uint64_t RANDOM_LINE_MIX_MULTIPLIER = 0xBF58476D1CE4E5B9ULL;
+
+// Version of the roofline file format, bumped whenever a probe or the set of probed values changes
+const int ROOFLINE_VERSION = 2;
+
+/**
+ * The bandwidth ceilings of the machine in GB/s, one per probed thread count.
+ */
+struct Roofline
+{
+  string signature;
+  vector<int> thread_counts;
+  vector<double> read_gbps;
+  vector<double> write_gbps;
+  vector<double> stream_write_gbps;
+  vector<double> random_write_gbps;
+};
+
+/**
+ * Get the data given a number.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Get a cache size from sysconf.
+ * @param name The sysconf name of the cache size.
+ * @param fallback The size to use if the cache size is not reported.
+ * @return The cache size in bytes.
+ */
+long get_cache_size(int name, long fallback)
+{
+  long size = sysconf(name);
+  return size > 0 ? size : fallback;
+}
+
+/**
+ * Get a signature of the hardware so that a roofline is only reused on the machine it was made on.
+ * @return The signature.
+ */
+string get_hardware_signature()
+{
+  stringstream signature;
+  signature << "v" << ROOFLINE_VERSION << "-" << thread::hardware_concurrency() << "c-"
+            << get_cache_size(_SC_LEVEL1_DCACHE_SIZE, 0) << "-" << get_cache_size(_SC_LEVEL2_CACHE_SIZE, 0) << "-"
+            << get_cache_size(_SC_LEVEL3_CACHE_SIZE, 0);
+  return signature.str();
+}
+
+/**
+ * Read a range of the probe buffer sequentially.
+ * Eight independent sums keep the loads from waiting on each other.
+ * @param words The probe buffer.
+ * @param start The first word of the range.
+ * @param end The end of the range.
+ * @return The sum of the words, so the loads cannot be removed.
+ */
+uint64_t read_range(const uint64_t *words, size_t start, size_t end)
+{
+  uint64_t sums[WORDS_PER_CACHE_LINE] = {0};
+  for (size_t j = start; j < end; j += WORDS_PER_CACHE_LINE)
+  {
+    for (int k = 0; k < WORDS_PER_CACHE_LINE; k++)
+    {
+      sums[k] += words[j + k];
+    }
+  }
+  uint64_t sum = 0;
+  for (int k = 0; k < WORDS_PER_CACHE_LINE; k++)
+  {
+    sum += sums[k];
+  }
+  return sum;
+}
+
+/**
+ * Write a range of the probe buffer sequentially.
+ * @param words The probe buffer.
+ * @param start The first word of the range.
+ * @param end The end of the range.
+ * @param value The value to write.
+ */
+void write_range(uint64_t *words, size_t start, size_t end, uint64_t value)
+{
+  for (size_t j = start; j < end; j++)
+  {
+    words[j] = value;
+  }
+}
+
+/**
+ * Write a range of the probe buffer sequentially with non-temporal stores, which bypass the caches and do not read
+ * the cache lines before writing them. Falls back to normal stores where they are not available.
+ * @param words The probe buffer.
+ * @param start The first word of the range.
+ * @param end The end of the range.
+ * @param value The value to write.
+ */
+void stream_write_range(uint64_t *words, size_t start, size_t end, uint64_t value)
+{
+#if defined(__x86_64__)
+  for (size_t j = start; j < end; j++)
+  {
+    _mm_stream_si64((long long *)&words[j], value);
+  }
+  _mm_sfence();
+#else
+  write_range(words, start, end, value);
+#endif
+}
+
+/**
+ * Get line i of a pseudo-random permutation of the cache lines. A multiplication by an odd number and an xorshift of
+ * the low bits are both bijections modulo a power of two, so alternating them gives a permutation without the
+ * constant stride that a multiplication alone has between consecutive lines.
+ * @param i The index in the permutation.
+ * @param num_of_lines The number of cache lines, a power of two.
+ * @return The cache line.
+ */
+size_t get_random_line(size_t i, size_t num_of_lines)
+{
+  uint64_t mask = num_of_lines - 1;
+  int shift = max(1, __builtin_ctzll(num_of_lines) / 2);
+  uint64_t line = (i * RANDOM_LINE_MULTIPLIER) & mask;
+  line ^= line >> shift;
+  line = (line * RANDOM_LINE_MIX_MULTIPLIER) & mask;
+  line ^= line >> shift;
+  return line;
+}
+
+/**
+ * Write whole cache lines of the probe buffer in a random order. The sequence is a permutation of the lines, so the
+ * threads write disjoint lines when they take disjoint parts of the sequence.
+ * @param words The probe buffer.
+ * @param num_of_lines The number of cache lines of the buffer, a power of two.
+ * @param start The first index of the sequence.
+ * @param end The end of the sequence.
+ * @param value The value to write.
+ */
+void random_write_range(uint64_t *words, size_t num_of_lines, size_t start, size_t end, uint64_t value)
+{
+  for (size_t i = start; i < end; i++)
+  {
+    uint64_t *line = words + get_random_line(i, num_of_lines) * WORDS_PER_CACHE_LINE;
+    for (int k = 0; k < WORDS_PER_CACHE_LINE; k++)
+    {
+      line[k] = value;
+    }
+  }
+}
+
+/**
+ * Measure the bandwidth of a probe kernel, the best of three runs.
+ * @param num_of_threads The number of threads.
+ * @param num_of_lines The number of cache lines every run touches.
+ * @param kernel The kernel, called with the thread id and the cache lines of the thread.
+ * @return The bandwidth in GB/s.
+ */
+double measure_bandwidth(int num_of_threads, size_t num_of_lines, function<void(int, size_t, size_t)> kernel)
+{
+  double best = 0;
+  size_t chunk_size = num_of_lines / num_of_threads;
+  for (int run = 0; run < 3; run++)
+  {
+    auto start_time = high_resolution_clock::now();
+    vector<thread> threads;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      size_t start = i * chunk_size;
+      size_t end = (i == num_of_threads - 1) ? num_of_lines : start + chunk_size;
+      threads.push_back(thread([&kernel, i, start, end]() {
+        pin_thread(i);
+        kernel(i, start, end);
+      }));
+    }
+    for (auto &t : threads)
+    {
+      t.join();
+    }
+    auto end_time = high_resolution_clock::now();
+    best = max(best, num_of_lines * 64.0 / duration<double, nano>(end_time - start_time).count());
+  }
+  return best;
+}
+
+/**
+ * Get the thread counts the probe runs at: the powers of two up to the number of cores, and the number of cores.
+ * @return The thread counts.
+ */
+vector<int> get_probe_thread_counts()
+{
+  int num_of_cores = max(1u, thread::hardware_concurrency());
+  vector<int> thread_counts;
+  for (int threads = 1; threads < num_of_cores; threads *= 2)
+  {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(num_of_cores);
+  return thread_counts;
+}
+
+/**
+ * Run the bandwidth probe.
+ * @param debug Whether to print the progress.
+ * @return The roofline.
+ */
+Roofline probe_roofline(bool debug)
+{
+  Roofline roofline;
+  roofline.signature = get_hardware_signature();
+  roofline.thread_counts = get_probe_thread_counts();
+
+  // A power of two between the limits, at least twice the last level cache
+  size_t probe_bytes = MIN_PROBE_BYTES;
+  while (probe_bytes < MAX_PROBE_BYTES && probe_bytes < 2 * (size_t)get_cache_size(_SC_LEVEL3_CACHE_SIZE, 0))
+  {
+    probe_bytes *= 2;
+  }
+  size_t num_of_lines = probe_bytes / 64;
+  // Zeroed here, which maps in every page before the first probe runs
+  vector<uint64_t> words(num_of_lines * WORDS_PER_CACHE_LINE);
+  uint64_t *buffer = words.data();
+  vector<uint64_t> sums(roofline.thread_counts.back());
+
+  for (int threads : roofline.thread_counts)
+  {
+    roofline.write_gbps.push_back(measure_bandwidth(threads, num_of_lines, [&](int, size_t start, size_t end) {
+      write_range(buffer, start * WORDS_PER_CACHE_LINE, end * WORDS_PER_CACHE_LINE, end);
+    }));
+    roofline.read_gbps.push_back(measure_bandwidth(threads, num_of_lines, [&](int thread_id, size_t start, size_t end) {
+      sums[thread_id] += read_range(buffer, start * WORDS_PER_CACHE_LINE, end * WORDS_PER_CACHE_LINE);
+    }));
+    roofline.stream_write_gbps.push_back(measure_bandwidth(threads, num_of_lines, [&](int, size_t start, size_t end) {
+      stream_write_range(buffer, start * WORDS_PER_CACHE_LINE, end * WORDS_PER_CACHE_LINE, end);
+    }));
+    roofline.random_write_gbps.push_back(measure_bandwidth(threads, num_of_lines, [&](int, size_t start, size_t end) {
+      random_write_range(buffer, num_of_lines, start, end, end);
+    }));
+    if (debug)
+    {
+      cout << "Probed " << threads << " threads (checksum " << sums[0] << ")" << endl;
+    }
+  }
+  return roofline;
+}
+
+/**
+ * Write a list of values as a single line of a roofline file.
+ * @param file The file to write to.
+ * @param name The name of the values.
+ * @param values The values.
+ */
+template <typename T>
+void write_roofline_values(ofstream &file, const string &name, const vector<T> &values)
+{
+  file << name;
+  for (const T &value : values)
+  {
+    file << " " << value;
+  }
+  file << endl;
+}
+
+/**
+ * Save a roofline to a file.
+ * @param filename The name of the file.
+ * @param roofline The roofline to save.
+ */
+void save_roofline(const string &filename, const Roofline &roofline)
+{
+  ofstream file(filename);
+  if (!file.is_open())
+  {
+    cerr << "Unable to open file: " << filename << endl;
+    return;
+  }
+  file << setprecision(6);
+  file << "signature " << roofline.signature << endl;
+  // Not read back, but lets roofline.py pick the same scatter ceiling as the program
+  file << "l1_size " << get_cache_size(_SC_LEVEL1_DCACHE_SIZE, 32768) << endl;
+  write_roofline_values(file, "thread_counts", roofline.thread_counts);
+  write_roofline_values(file, "read_gbps", roofline.read_gbps);
+  write_roofline_values(file, "write_gbps", roofline.write_gbps);
+  write_roofline_values(file, "stream_write_gbps", roofline.stream_write_gbps);
+  write_roofline_values(file, "random_write_gbps", roofline.random_write_gbps);
+}
+
+/**
+ * Load a roofline from a file.
+ * @param filename The name of the file.
+ * @param roofline The roofline to load into.
+ * @return Whether a complete roofline could be loaded.
+ */
+bool load_roofline(const string &filename, Roofline &roofline)
+{
+  ifstream file(filename);
+  if (!file.is_open())
+  {
+    return false;
+  }
+
+  string line;
+  while (getline(file, line))
+  {
+    stringstream values(line);
+    string name;
+    values >> name;
+    if (name == "signature")
+    {
+      values >> roofline.signature;
+      continue;
+    }
+    vector<double> list;
+    double value;
+    while (values >> value)
+    {
+      list.push_back(value);
+    }
+    if (name == "thread_counts")
+    {
+      roofline.thread_counts.assign(list.begin(), list.end());
+    }
+    else if (name == "read_gbps")
+    {
+      roofline.read_gbps = list;
+    }
+    else if (name == "write_gbps")
+    {
+      roofline.write_gbps = list;
+    }
+    else if (name == "stream_write_gbps")
+    {
+      roofline.stream_write_gbps = list;
+    }
+    else if (name == "random_write_gbps")
+    {
+      roofline.random_write_gbps = list;
+    }
+  }
+
+  size_t points = roofline.thread_counts.size();
+  return points > 0 && roofline.read_gbps.size() == points && roofline.write_gbps.size() == points &&
+         roofline.stream_write_gbps.size() == points && roofline.random_write_gbps.size() == points;
+}
+
+/**
+ * Get the ceiling for a number of threads: the one probed at the largest thread count not above it, since threads
+ * beyond the probed ones share the same cores.
+ * @param roofline The roofline.
+ * @param ceilings One of the ceilings of the roofline.
+ * @param num_of_threads The number of threads.
+ * @return The ceiling in GB/s.
+ */
+double get_ceiling(const Roofline &roofline, const vector<double> &ceilings, int num_of_threads)
+{
+  size_t index = 0;
+  while (index + 1 < roofline.thread_counts.size() && roofline.thread_counts[index + 1] <= num_of_threads)
+  {
+    index++;
+  }
+  return ceilings[index];
+}
+
+/**
+ * Print the roofline.
+ * @param roofline The roofline.
+ */
+void print_roofline(const Roofline &roofline)
+{
+  cout << fixed << setprecision(2);
+  cout << "Bandwidth ceilings (GB/s):" << endl;
+  for (size_t i = 0; i < roofline.thread_counts.size(); i++)
+  {
+    cout << "\t" << roofline.thread_counts[i] << " threads: read " << roofline.read_gbps[i]
+         << ", write " << roofline.write_gbps[i]
+         << ", non-temporal write " << roofline.stream_write_gbps[i]
+         << ", random cache-line write " << roofline.random_write_gbps[i] << endl;
+  }
+  cout.unsetf(ios_base::floatfield);
+}
+
+/**
+ * Count the number of tuples per bucket for a chunk.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_buckets The number of buckets.
+ * @param histogram The histogram of the thread.
+ */
+void count_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                 vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    histogram[get_partition(get<0>(data[j]), num_of_buckets)]++;
+  }
+}
+
+/**
+ * Scatter a chunk.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param offsets The write offsets of the thread.
+ * @param output The output to scatter to.
+ */
+void scatter_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                   vector<int> &offsets, vector<tuple<int64_t, int64_t>> &output)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    output[offsets[get_partition(get<0>(data[j]), num_of_buckets)]++] = data[j];
+  }
+}
+
+/**
+ * Verify the output: every tuple is in its bucket and the buckets hold all tuples.
+ * @param output The partitioned data.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ * @return True if the output is partitioned correctly, false otherwise.
+ */
+bool verify_output(const vector<tuple<int64_t, int64_t>> &output, const vector<int> &bucket_start)
+{
+  int num_of_buckets = bucket_start.size() - 1;
+  int64_t sum = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    for (int j = bucket_start[b]; j < bucket_start[b + 1]; j++)
+    {
+      if (get_partition(get<0>(output[j]), num_of_buckets) != b)
+      {
+        return false;
+      }
+      sum += get<0>(output[j]);
+    }
+  }
+  int64_t n = output.size();
+  return bucket_start[num_of_buckets] == n && sum == n * (n + 1) / 2;
+}
+
+/**
+ * Print how a pass compares to its ceiling.
+ * @param name The name of the pass.
+ * @param bytes The bytes moved by the pass.
+ * @param ms The time of the pass in milliseconds.
+ * @param ceiling_name The name of the ceiling.
+ * @param ceiling_gbps The ceiling in GB/s.
+ */
+void print_pass(const string &name, double bytes, double ms, const string &ceiling_name, double ceiling_gbps)
+{
+  double gbps = bytes / (ms * 1e6);
+  cout << "\t" << name << ": " << gbps << " GB/s, " << gbps / ceiling_gbps * 100 << "% of " << ceiling_name
+       << " (" << ceiling_gbps << " GB/s)" << endl;
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [roofline_file]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 roofline.txt" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param roofline_file The roofline file, empty to always probe.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  const string &roofline_file)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tRoofline file: " << (roofline_file.empty() ? "none" : roofline_file) << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc != 6 && argc != 7)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  string roofline_file = argc == 7 ? argv[6] : "";
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, roofline_file);
+
+  Roofline roofline;
+  if (roofline_file.empty() || !load_roofline(roofline_file, roofline) || roofline.signature != get_hardware_signature())
+  {
+    cout << "Probing memory bandwidth..." << endl;
+    roofline = probe_roofline(debug);
+    if (!roofline_file.empty())
+    {
+      save_roofline(roofline_file, roofline);
+    }
+  }
+  print_roofline(roofline);
+
+  auto data = get_data_given_n(data_size);
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+  vector<tuple<int64_t, int64_t>> output(data_size);
+  vector<int> bucket_start(num_of_buckets + 1);
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, i, start, end, cref(data), num_of_buckets, ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  auto count_time = high_resolution_clock::now();
+
+  int offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    bucket_start[b] = offset;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+  }
+  bucket_start[num_of_buckets] = offset;
+
+  auto offsets_time = high_resolution_clock::now();
+
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk, i, start, end, cref(data), num_of_buckets, ref(histograms[i]), ref(output)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  double count_ms = chrono::duration<double, milli>(count_time - start_time).count();
+  double scatter_ms = chrono::duration<double, milli>(end_time - offsets_time).count();
+  double total_ms = chrono::duration<double, milli>(end_time - start_time).count();
+  double data_bytes = (double)data_size * sizeof(tuple<int64_t, int64_t>);
+
+  // The scatter writes to one cache line per bucket at a time; once these lines no longer fit into the L1 cache the
+  // writes behave like writes of random cache lines
+  bool sequential_scatter = (long)num_of_buckets * 64 <= get_cache_size(_SC_LEVEL1_DCACHE_SIZE, 32768);
+  double read_ceiling = get_ceiling(roofline, roofline.read_gbps, num_of_threads);
+  double write_ceiling = sequential_scatter ? get_ceiling(roofline, roofline.write_gbps, num_of_threads)
+                                            : get_ceiling(roofline, roofline.random_write_gbps, num_of_threads);
+  string write_ceiling_name = sequential_scatter ? "sequential write" : "random cache-line write";
+
+  // The best possible time reads the input twice and writes the output once at the ceilings
+  double roofline_ms = (2 * data_bytes / read_ceiling + data_bytes / write_ceiling) / 1e6;
+
+  cout << fixed << setprecision(2);
+  cout << "Partitioning against the roofline:" << endl;
+  print_pass("Count pass (read)", data_bytes, count_ms, "read", read_ceiling);
+  print_pass("Scatter pass (write)", data_bytes, scatter_ms, write_ceiling_name, write_ceiling);
+  print_pass("Scatter pass (write)", data_bytes, scatter_ms, "non-temporal write",
+             get_ceiling(roofline, roofline.stream_write_gbps, num_of_threads));
+  cout << "\tTotal: " << total_ms << " ms, " << roofline_ms / total_ms * 100 << "% of the two-pass roofline ("
+       << roofline_ms << " ms)" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    cout << "Output verified: " << (verify_output(output, bucket_start) ? "yes" : "NO") << endl;
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
@@ -0,0 +1,44 @@
+import sys
+import pandas as pd
+
+# Usage: python3 roofline.py [roofline_file] [metrics_file]
+# The roofline file is written by roofline-partition. Every run in the metrics file is compared to the time it takes
+# to read its input once and write its output once at the bandwidth ceilings of its thread count.
+roofline_file = sys.argv[1] if len(sys.argv) > 1 else "roofline.txt"
+metrics_file = sys.argv[2] if len(sys.argv) > 2 else "metrics.csv"
+
+roofline = {}
+with open(roofline_file) as file:
+    for line in file:
+        name, *values = line.split()
+        if name != "signature":
+            roofline[name] = [float(value) for value in values]
+thread_counts = roofline["thread_counts"]
+
+
+def get_ceiling(name, threads):
+    # The ceiling of the largest probed thread count not above the number of threads
+    index = max([i for i, count in enumerate(thread_counts) if count <= threads] or [0])
+    return roofline[name][index]
+
+
+def get_roofline_ms(row):
+    data_bytes = row['data_size'] * 16
+    # One cache line per bucket in the L1 cache: the writes are sequential, beyond that they go to random lines
+    sequential = row['buckets'] * 64 <= roofline["l1_size"][0]
+    write_gbps = get_ceiling("write_gbps" if sequential else "random_write_gbps", row['threads'])
+    return (data_bytes / get_ceiling("read_gbps", row['threads']) + data_bytes / write_gbps) / 1e6
+
+
+metrics_df = pd.read_csv(metrics_file)
+mean_df = metrics_df.groupby(['algorithm', 'threads', 'hashbits', 'buckets', 'data_size'], as_index=False)['duration'].mean()
+mean_df = mean_df[mean_df['duration'] > 0]
+mean_df['roofline_percent'] = mean_df.apply(get_roofline_ms, axis=1) / mean_df['duration'] * 100
+
+# Print the share of the roofline per hash bit using the largest thread count of every algorithm
+for algorithm, algorithm_df in mean_df.groupby('algorithm'):
+    max_threads = algorithm_df['threads'].max()
+    table = algorithm_df[algorithm_df['threads'] == max_threads].set_index('hashbits')['roofline_percent']
+    print(f"{algorithm} with {max_threads} threads, % of the roofline per hash bit")
+    print(table.round(1).to_string())
+    print()
@@ -0,0 +1,614 @@
+/**
+ * This program estimates the bucket sizes from a small random sample of the keys instead of counting every key.
+ * Every thread samples its chunk, the sample histograms are merged and every (bucket, thread) pair gets an output
+ * region sized from the estimate plus some headroom. The threads then scatter their chunk into their own regions in
+ * a single pass without any shared atomics, and tuples that do not fit are put in a per-thread spill area which is
+ * partitioned and merged into the buckets at the end.
+ * For comparison the same data is also partitioned with the exact two-pass count-then-scatter, and the sample size,
+ * the overflow rate and the throughput of both are reported.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param sample_size (optional) The number of keys sampled. Defaults to 65536.
+ * @param headroom (optional) The headroom added to every estimated region in percent. Defaults to 10.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "sampled-partition";
+
+// Name the exact count pass is recorded under in the CSV file
+const string EXACT_PROGRAM_NAME = "exact-count-partition";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+/**
+ * The partitioned data of the sampled mode. Bucket b consists of the region of every thread t, stored at index
+ * r = b * num_of_threads + t: region_start[r] to region_start[r] + region_fill[r] - 1 in output. The regions are
+ * followed by the spilled tuples of the bucket, spill_start[b] to spill_start[b + 1] - 1 in spill.
+ */
+struct SampledPartitions
+{
+  int num_of_threads;
+  vector<tuple<int64_t, int64_t>> output;
+  vector<int64_t> region_start;
+  vector<int> region_fill;
+  vector<tuple<int64_t, int64_t>> spill;
+  vector<int> spill_start;
+};
+
+/**
+ * A read-only view of a single bucket of the sampled mode that hides where every tuple ended up.
+ */
+class SampledBucketView
+{
+public:
+  /**
+   * Create a view of a bucket.
+   * @param partitions The partitioned data.
+   * @param bucket The bucket to view.
+   */
+  SampledBucketView(const SampledPartitions &partitions, int bucket) : partitions(partitions), bucket(bucket)
+  {
+  }
+
+  /**
+   * Get the number of tuples in the bucket.
+   * @return The number of tuples.
+   */
+  int size() const
+  {
+    int size = partitions.spill_start[bucket + 1] - partitions.spill_start[bucket];
+    for (int t = 0; t < partitions.num_of_threads; t++)
+    {
+      size += partitions.region_fill[bucket * partitions.num_of_threads + t];
+    }
+    return size;
+  }
+
+  /**
+   * Get a tuple of the bucket.
+   * @param i The index of the tuple within the bucket.
+   * @return The tuple.
+   */
+  const tuple<int64_t, int64_t> &operator[](int i) const
+  {
+    for (int t = 0; t < partitions.num_of_threads; t++)
+    {
+      int region = bucket * partitions.num_of_threads + t;
+      if (i < partitions.region_fill[region])
+      {
+        return partitions.output[partitions.region_start[region] + i];
+      }
+      i -= partitions.region_fill[region];
+    }
+    return partitions.spill[partitions.spill_start[bucket] + i];
+  }
+
+private:
+  const SampledPartitions &partitions;
+  int bucket;
+};
+
+/**
+ * Get the data given a number.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    data[i] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Sample random keys of a chunk into a histogram.
+ * @param thread_id The id of the thread, also used as the seed so runs are reproducible.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to sample.
+ * @param num_of_buckets The number of buckets.
+ * @param num_of_samples The number of keys to sample from the chunk.
+ * @param histogram The sample histogram of the thread.
+ */
+void sample_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                  int num_of_samples, vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  if (end <= start)
+  {
+    return;
+  }
+  mt19937 generator(thread_id + 1);
+  uniform_int_distribution<int> index(start, end - 1);
+  for (int s = 0; s < num_of_samples; s++)
+  {
+    histogram[get_partition(get<0>(data[index(generator)]), num_of_buckets)]++;
+  }
+}
+
+/**
+ * Scatter a chunk into the regions of the thread. Tuples whose region is full go to the spill area of the thread.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param partitions The partitioned data to write to.
+ * @param region_end The end of the region of this thread in every bucket.
+ * @param spill The spill area of the thread.
+ */
+void scatter_sampled_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data,
+                           int num_of_buckets, SampledPartitions &partitions, const vector<int64_t> &region_end,
+                           vector<tuple<int64_t, int64_t>> &spill)
+{
+  pin_thread(thread_id);
+  vector<int64_t> offsets(num_of_buckets);
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    offsets[b] = partitions.region_start[b * partitions.num_of_threads + thread_id];
+  }
+
+  for (int j = start; j < end; j++)
+  {
+    int partition = get_partition(get<0>(data[j]), num_of_buckets);
+    if (offsets[partition] < region_end[partition])
+    {
+      partitions.output[offsets[partition]++] = data[j];
+    }
+    else
+    {
+      spill.push_back(data[j]);
+    }
+  }
+
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    int region = b * partitions.num_of_threads + thread_id;
+    partitions.region_fill[region] = offsets[b] - partitions.region_start[region];
+  }
+}
+
+/**
+ * Partition the data using bucket sizes estimated from a sample.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads to use.
+ * @param num_of_buckets The number of buckets.
+ * @param sample_size The total number of keys to sample.
+ * @param headroom The fraction added to every estimated region.
+ * @param spilled The number of tuples that did not fit their region.
+ * @param capacity The total number of output slots allocated for the regions.
+ * @return The partitioned data.
+ */
+SampledPartitions run_sampled(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads, int num_of_buckets,
+                              int sample_size, double headroom, long &spilled, int64_t &capacity)
+{
+  int data_size = data.size();
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  SampledPartitions partitions;
+
+  // Sample every chunk in proportion to its size
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    int num_of_samples = (int)((int64_t)sample_size * (end - start) / max(1, data_size));
+    threads.push_back(thread(sample_chunk, i, start, end, ref(data), num_of_buckets, num_of_samples,
+                             ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  // Estimate the share of every bucket with add-one smoothing, so buckets the sample missed still get a region
+  vector<double> share(num_of_buckets);
+  int64_t sampled = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    int count = 0;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      count += histograms[i][b];
+    }
+    share[b] = count + 1;
+    sampled += count + 1;
+  }
+
+  // Lay out the regions bucket by bucket, so the regions of a bucket are next to each other
+  partitions.num_of_threads = num_of_threads;
+  partitions.region_start.assign((int64_t)num_of_buckets * num_of_threads, 0);
+  partitions.region_fill.assign((int64_t)num_of_buckets * num_of_threads, 0);
+  vector<vector<int64_t>> region_end(num_of_threads, vector<int64_t>(num_of_buckets));
+  int64_t offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int chunk_length = (i == num_of_threads - 1) ? data_size - i * chunk_size : chunk_size;
+      double estimate = share[b] / sampled * chunk_length;
+      partitions.region_start[b * num_of_threads + i] = offset;
+      offset += (int64_t)ceil(estimate * (1 + headroom));
+      region_end[i][b] = offset;
+    }
+  }
+  capacity = offset;
+  partitions.output.resize(offset);
+
+  vector<vector<tuple<int64_t, int64_t>>> spills(num_of_threads);
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_sampled_chunk, i, start, end, ref(data), num_of_buckets, ref(partitions),
+                             cref(region_end[i]), ref(spills[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  // Merge the spill areas into a single spill partitioned by bucket. It is small, so one thread is enough.
+  partitions.spill_start.assign(num_of_buckets + 1, 0);
+  for (const vector<tuple<int64_t, int64_t>> &spill : spills)
+  {
+    for (const tuple<int64_t, int64_t> &item : spill)
+    {
+      partitions.spill_start[get_partition(get<0>(item), num_of_buckets) + 1]++;
+    }
+  }
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    partitions.spill_start[b + 1] += partitions.spill_start[b];
+  }
+  spilled = partitions.spill_start[num_of_buckets];
+  partitions.spill.resize(spilled);
+  vector<int> spill_offsets(partitions.spill_start.begin(), partitions.spill_start.end() - 1);
+  for (const vector<tuple<int64_t, int64_t>> &spill : spills)
+  {
+    for (const tuple<int64_t, int64_t> &item : spill)
+    {
+      partitions.spill[spill_offsets[get_partition(get<0>(item), num_of_buckets)]++] = item;
+    }
+  }
+  return partitions;
+}
+
+/**
+ * Count a chunk of data into a histogram.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_buckets The number of buckets.
+ * @param histogram The histogram of the thread.
+ */
+void count_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                 vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    histogram[get_partition(get<0>(data[j]), num_of_buckets)]++;
+  }
+}
+
+/**
+ * Scatter a chunk of data given the write offset of the thread in every bucket.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param offsets The write offsets of the thread.
+ * @param output The output to scatter to.
+ */
+void scatter_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                   vector<int> &offsets, vector<tuple<int64_t, int64_t>> &output)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    output[offsets[get_partition(get<0>(data[j]), num_of_buckets)]++] = data[j];
+  }
+}
+
+/**
+ * Partition the data with the exact two-pass count-then-scatter.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads to use.
+ * @param num_of_buckets The number of buckets.
+ * @param output The partitioned data, bucket by bucket.
+ */
+void run_exact(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads, int num_of_buckets,
+               vector<tuple<int64_t, int64_t>> &output)
+{
+  int data_size = data.size();
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, i, start, end, ref(data), num_of_buckets, ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  int offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+  }
+
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk, i, start, end, ref(data), num_of_buckets, ref(histograms[i]),
+                             ref(output)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+}
+
+/**
+ * Check that every tuple of the sampled mode is in its bucket and that no tuple was lost.
+ * @param partitions The partitioned data.
+ * @param num_of_buckets The number of buckets.
+ * @param data_size The size of the data.
+ * @return Whether the partitioning is correct.
+ */
+bool verify_output(const SampledPartitions &partitions, int num_of_buckets, int data_size)
+{
+  long total = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    SampledBucketView bucket(partitions, b);
+    for (int j = 0; j < bucket.size(); j++)
+    {
+      if (get_partition(get<0>(bucket[j]), num_of_buckets) != b)
+      {
+        return false;
+      }
+    }
+    total += bucket.size();
+  }
+  return total == data_size;
+}
+
+/**
+ * Print the output vector.
+ * @param partitions The partitioned data.
+ * @param num_of_buckets The number of buckets to use.
+ */
+void print_output(const SampledPartitions &partitions, int num_of_buckets)
+{
+  cout << "Data (first 10 elements from each partition): " << endl;
+  for (int b = 0; b < min(num_of_buckets, 16); b++)
+  {
+    SampledBucketView bucket(partitions, b);
+    cout << "Partition " << b << " (size: " << bucket.size() << "): ";
+    for (int j = 0; j < min(10, bucket.size()); j++)
+    {
+      cout << "(" << get<0>(bucket[j]) << "," << get<1>(bucket[j]) << ") ";
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [sample_size] [headroom]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 65536 10" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param sample_size The number of keys sampled.
+ * @param headroom The headroom in percent.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  int sample_size, int headroom)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tSample size: " << sample_size << endl;
+  cout << "\tHeadroom: " << headroom << "%" << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record the metrics under.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc < 6 || argc > 8)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  int sample_size = argc > 6 ? stoi(argv[6]) : 65536;
+  int headroom = argc > 7 ? stoi(argv[7]) : 10;
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, sample_size, headroom);
+
+  auto data = get_data_given_n(data_size);
+
+  long spilled = 0;
+  int64_t capacity = 0;
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+  SampledPartitions partitions = run_sampled(data, num_of_threads, num_of_buckets, sample_size, headroom / 100.0,
+                                             spilled, capacity);
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  // The output is allocated inside the timed region for both modes, since the sampled mode only knows its size then
+  auto exact_start_time = high_resolution_clock::now();
+  vector<tuple<int64_t, int64_t>> exact_output(data_size);
+  run_exact(data, num_of_threads, num_of_buckets, exact_output);
+  auto exact_end_time = high_resolution_clock::now();
+  auto exact_duration = duration_cast<milliseconds>(exact_end_time - exact_start_time);
+
+  double sampled_ms = chrono::duration<double, milli>(end_time - start_time).count();
+  double exact_ms = chrono::duration<double, milli>(exact_end_time - exact_start_time).count();
+  cout << fixed << setprecision(2);
+  cout << "Sample size: " << sample_size << " keys (" << 100.0 * sample_size / max(1, data_size) << "% of the data)" << endl;
+  cout << "Overflow rate: " << 100.0 * spilled / max(1, data_size) << "% (" << spilled << " tuples spilled)" << endl;
+  cout << "Allocated slots: " << (double)capacity / max(1, data_size) << "x the data size" << endl;
+  cout << "Sampled: " << sampled_ms << " ms (" << data_size / sampled_ms / 1000 << " MT/s)" << endl;
+  cout << "Exact count pass: " << exact_ms << " ms (" << data_size / exact_ms / 1000 << " MT/s)" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    cout << "Output verified: " << (verify_output(partitions, num_of_buckets, data_size) ? "yes" : "NO") << endl;
+    print_output(partitions, num_of_buckets);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+  append_metrics_to_csv(filename, EXACT_PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, exact_duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
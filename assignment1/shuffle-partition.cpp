@@ -0,0 +1,714 @@
+/**
+ * This program is a local stand-in for a distributed shuffle.
+ * Several worker processes each generate and partition their slice of the data with a count pass and a scatter pass,
+ * and then send bucket b to process b % num_of_processes. Every pair of processes is connected by a single-producer
+ * single-consumer ring buffer in one POSIX shared memory object. A process interleaves sending into its outgoing rings
+ * with receiving from its incoming rings, so bounded rings never deadlock. The tuples a process keeps for itself are
+ * copied directly. Every process reports its send and receive bandwidth and the parent reports the end-to-end time.
+ * @param num_of_threads The number of threads used per process for partitioning.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used, over all processes.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param num_of_processes (optional) The number of worker processes. Defaults to 4.
+ * @param ring_size (optional) The number of tuples per ring buffer, a power of two. Defaults to 65536.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <csignal>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "shm-shuffle";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// Largest supported number of worker processes
+const int MAX_PROCESSES = 64;
+
+/**
+ * The control block at the start of the shared memory object. Takes a whole cache line, which keeps the counts after
+ * it aligned.
+ */
+struct alignas(64) ShuffleHeader
+{
+  // Barrier counters: processes that have generated their data, that are done partitioning and that are done shuffling
+  atomic<int> ready;
+  atomic<int> partitioned;
+  atomic<int> shuffled;
+};
+
+/**
+ * What a process reports back to the parent.
+ */
+struct ProcessResult
+{
+  // Steady clock times in nanoseconds, comparable between processes: leaving the start barrier and done shuffling
+  int64_t start_ns;
+  int64_t end_ns;
+  double partition_ms;
+  double shuffle_ms;
+  int64_t bytes_sent;
+  int64_t bytes_received;
+  int64_t key_sum;
+  int64_t misplaced;
+};
+
+/**
+ * A single-producer single-consumer ring buffer, followed in the shared memory object by its tuples.
+ * The head and the tail are on their own cache lines and only ever grow.
+ */
+struct Ring
+{
+  alignas(64) atomic<uint64_t> head;
+  alignas(64) atomic<uint64_t> tail;
+};
+
+/**
+ * The shared memory object: header, tuple counts from every process to every process, results and the rings.
+ */
+class ShuffleSegment
+{
+public:
+  ShuffleSegment(char *base, int num_of_processes, int ring_size)
+      : base_(base), num_of_processes_(num_of_processes), ring_size_(ring_size) {}
+
+  static size_t size(int num_of_processes, int ring_size)
+  {
+    return rings_offset(num_of_processes) + (size_t)num_of_processes * num_of_processes * ring_bytes(ring_size);
+  }
+
+  ShuffleHeader &header()
+  {
+    return *(ShuffleHeader *)base_;
+  }
+
+  int64_t &count(int sender, int receiver)
+  {
+    return ((int64_t *)(base_ + sizeof(ShuffleHeader)))[sender * num_of_processes_ + receiver];
+  }
+
+  ProcessResult &result(int process)
+  {
+    return ((ProcessResult *)(base_ + results_offset(num_of_processes_)))[process];
+  }
+
+  Ring &ring(int sender, int receiver)
+  {
+    return *(Ring *)(base_ + rings_offset(num_of_processes_) +
+                     (size_t)(sender * num_of_processes_ + receiver) * ring_bytes(ring_size_));
+  }
+
+  tuple<int64_t, int64_t> *ring_tuples(int sender, int receiver)
+  {
+    return (tuple<int64_t, int64_t> *)(&ring(sender, receiver) + 1);
+  }
+
+  int ring_size() const
+  {
+    return ring_size_;
+  }
+
+private:
+  static size_t results_offset(int num_of_processes)
+  {
+    return sizeof(ShuffleHeader) + (size_t)num_of_processes * num_of_processes * sizeof(int64_t);
+  }
+
+  static size_t rings_offset(int num_of_processes)
+  {
+    size_t end = results_offset(num_of_processes) + num_of_processes * sizeof(ProcessResult);
+    return (end + 63) / 64 * 64;
+  }
+
+  // Rounded up to a cache line so that every ring starts aligned, whatever the ring size
+  static size_t ring_bytes(int ring_size)
+  {
+    return (sizeof(Ring) + (size_t)ring_size * sizeof(tuple<int64_t, int64_t>) + 63) / 64 * 64;
+  }
+
+  char *base_;
+  int num_of_processes_;
+  int ring_size_;
+};
+
+/**
+ * Where a process is in sending the buckets of one receiver.
+ */
+struct SendCursor
+{
+  int bucket;
+  int offset;
+  int64_t remaining;
+};
+
+/**
+ * Get the slice of the data of a process. The keys are those of the whole data set.
+ * @param start The index of the first tuple of the slice.
+ * @param end The end of the slice.
+ * @return The data of the slice.
+ */
+vector<tuple<int64_t, int64_t>> get_data_slice(int start, int end)
+{
+  vector<tuple<int64_t, int64_t>> data(end - start);
+  for (int64_t i = start; i < end; i++)
+  {
+    data[i - start] = tuple<int64_t, int64_t>(i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Count the number of tuples per bucket for a chunk.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_buckets The number of buckets.
+ * @param histogram The histogram of the thread.
+ */
+void count_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                 vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    histogram[get_partition(get<0>(data[j]), num_of_buckets)]++;
+  }
+}
+
+/**
+ * Scatter a chunk.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param offsets The write offsets of the thread.
+ * @param output The output to scatter to.
+ */
+void scatter_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                   vector<int> &offsets, vector<tuple<int64_t, int64_t>> &output)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    output[offsets[get_partition(get<0>(data[j]), num_of_buckets)]++] = data[j];
+  }
+}
+
+/**
+ * Partition the data with a count pass and a scatter pass.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads.
+ * @param first_thread_id The id of the first thread, to pin the threads of different processes to different cores.
+ * @param num_of_buckets The number of buckets.
+ * @param output The partitioned data.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ */
+void run_partitioning(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads, int first_thread_id,
+                      int num_of_buckets, vector<tuple<int64_t, int64_t>> &output, vector<int> &bucket_start)
+{
+  int data_size = data.size();
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, first_thread_id + i, start, end, cref(data), num_of_buckets,
+                             ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  int offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    bucket_start[b] = offset;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+  }
+  bucket_start[num_of_buckets] = offset;
+
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk, first_thread_id + i, start, end, cref(data), num_of_buckets,
+                             ref(histograms[i]), ref(output)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+}
+
+/**
+ * Wait until all processes have arrived at a barrier.
+ * @param counter The counter of the barrier.
+ * @param num_of_processes The number of processes.
+ */
+void wait_for_all(atomic<int> &counter, int num_of_processes)
+{
+  counter.fetch_add(1, memory_order_acq_rel);
+  while (counter.load(memory_order_acquire) < num_of_processes)
+  {
+    this_thread::yield();
+  }
+}
+
+/**
+ * Push as many tuples of the next buckets of a receiver into its ring as fit.
+ * @param ring The ring to the receiver.
+ * @param ring_tuples The tuples of the ring.
+ * @param ring_size The number of tuples of the ring.
+ * @param cursor Where the process is in sending to the receiver.
+ * @param output The partitioned data.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ * @param num_of_processes The number of processes, the distance between two buckets of the same receiver.
+ * @return The number of tuples pushed.
+ */
+int64_t push_some(Ring &ring, tuple<int64_t, int64_t> *ring_tuples, int ring_size, SendCursor &cursor,
+                  const vector<tuple<int64_t, int64_t>> &output, const vector<int> &bucket_start,
+                  int num_of_processes)
+{
+  uint64_t tail = ring.tail.load(memory_order_relaxed);
+  uint64_t free_slots = ring_size - (tail - ring.head.load(memory_order_acquire));
+  int64_t pushed = 0;
+  while (free_slots > 0 && cursor.remaining > 0)
+  {
+    int bucket_end = bucket_start[cursor.bucket + 1];
+    if (bucket_start[cursor.bucket] + cursor.offset == bucket_end)
+    {
+      cursor.bucket += num_of_processes;
+      cursor.offset = 0;
+      continue;
+    }
+    int position = tail % ring_size;
+    int64_t n = min<int64_t>(min<int64_t>(free_slots, ring_size - position),
+                             bucket_end - bucket_start[cursor.bucket] - cursor.offset);
+    copy_n(output.data() + bucket_start[cursor.bucket] + cursor.offset, n, ring_tuples + position);
+    cursor.offset += n;
+    cursor.remaining -= n;
+    tail += n;
+    free_slots -= n;
+    pushed += n;
+  }
+  ring.tail.store(tail, memory_order_release);
+  return pushed;
+}
+
+/**
+ * Pop all available tuples from a ring.
+ * @param ring The ring from the sender.
+ * @param ring_tuples The tuples of the ring.
+ * @param ring_size The number of tuples of the ring.
+ * @param destination Where to copy the tuples to.
+ * @return The number of tuples popped.
+ */
+int64_t pop_some(Ring &ring, const tuple<int64_t, int64_t> *ring_tuples, int ring_size,
+                 tuple<int64_t, int64_t> *destination)
+{
+  uint64_t head = ring.head.load(memory_order_relaxed);
+  uint64_t available = ring.tail.load(memory_order_acquire) - head;
+  int64_t popped = 0;
+  while (available > 0)
+  {
+    int position = head % ring_size;
+    int64_t n = min<int64_t>(available, ring_size - position);
+    copy_n(ring_tuples + position, n, destination + popped);
+    head += n;
+    available -= n;
+    popped += n;
+  }
+  ring.head.store(head, memory_order_release);
+  return popped;
+}
+
+/**
+ * Run one worker process: partition the slice, exchange the buckets and report the results.
+ * @param segment The shared memory object.
+ * @param process The id of the process.
+ * @param num_of_processes The number of processes.
+ * @param num_of_threads The number of threads per process.
+ * @param num_of_buckets The number of buckets.
+ * @param data_size The size of the data over all processes.
+ */
+void run_worker(ShuffleSegment &segment, int process, int num_of_processes, int num_of_threads, int num_of_buckets,
+                int data_size)
+{
+  int slice_size = compute_input_chunk_size(data_size, num_of_processes);
+  int slice_start = process * slice_size;
+  int slice_end = (process == num_of_processes - 1) ? data_size : slice_start + slice_size;
+  auto data = get_data_slice(slice_start, slice_end);
+  vector<tuple<int64_t, int64_t>> output(data.size());
+  vector<int> bucket_start(num_of_buckets + 1);
+
+  // Start together once every process has its data, so that generating it is not timed
+  wait_for_all(segment.header().ready, num_of_processes);
+
+  auto start_time = steady_clock::now();
+  run_partitioning(data, num_of_threads, process * num_of_threads, num_of_buckets, output, bucket_start);
+  auto partition_time = steady_clock::now();
+
+  // Tell every receiver how much to expect
+  vector<SendCursor> cursors(num_of_processes);
+  for (int r = 0; r < num_of_processes; r++)
+  {
+    int64_t count = 0;
+    for (int b = r; b < num_of_buckets; b += num_of_processes)
+    {
+      count += bucket_start[b + 1] - bucket_start[b];
+    }
+    segment.count(process, r) = count;
+    cursors[r].bucket = r;
+    cursors[r].offset = 0;
+    cursors[r].remaining = count;
+  }
+  wait_for_all(segment.header().partitioned, num_of_processes);
+
+  auto shuffle_start_time = steady_clock::now();
+
+  // The tuples from every sender go into their own range of the received tuples
+  vector<int64_t> received_start(num_of_processes + 1, 0);
+  for (int s = 0; s < num_of_processes; s++)
+  {
+    received_start[s + 1] = received_start[s] + segment.count(s, process);
+  }
+  vector<tuple<int64_t, int64_t>> received(received_start[num_of_processes]);
+  vector<int64_t> received_count(num_of_processes, 0);
+
+  // Keep the own buckets without going through a ring
+  for (int b = process; b < num_of_buckets; b += num_of_processes)
+  {
+    int n = bucket_start[b + 1] - bucket_start[b];
+    copy_n(output.data() + bucket_start[b], n, received.data() + received_start[process] + received_count[process]);
+    received_count[process] += n;
+  }
+  cursors[process].remaining = 0;
+
+  int64_t sent = 0;
+  int64_t total_received = 0;
+  bool done = false;
+  while (!done)
+  {
+    done = true;
+    bool progress = false;
+    for (int r = 0; r < num_of_processes; r++)
+    {
+      if (cursors[r].remaining > 0)
+      {
+        int64_t n = push_some(segment.ring(process, r), segment.ring_tuples(process, r), segment.ring_size(),
+                              cursors[r], output, bucket_start, num_of_processes);
+        sent += n;
+        progress = progress || n > 0;
+        done = done && cursors[r].remaining == 0;
+      }
+    }
+    for (int s = 0; s < num_of_processes; s++)
+    {
+      if (s != process && received_count[s] < segment.count(s, process))
+      {
+        int64_t n = pop_some(segment.ring(s, process), segment.ring_tuples(s, process), segment.ring_size(),
+                             received.data() + received_start[s] + received_count[s]);
+        received_count[s] += n;
+        total_received += n;
+        progress = progress || n > 0;
+        done = done && received_count[s] == segment.count(s, process);
+      }
+    }
+    if (!progress)
+    {
+      this_thread::yield();
+    }
+  }
+
+  auto end_time = steady_clock::now();
+
+  ProcessResult &result = segment.result(process);
+  result.start_ns = duration_cast<nanoseconds>(start_time.time_since_epoch()).count();
+  result.end_ns = duration_cast<nanoseconds>(end_time.time_since_epoch()).count();
+  result.partition_ms = chrono::duration<double, milli>(partition_time - start_time).count();
+  result.shuffle_ms = chrono::duration<double, milli>(end_time - shuffle_start_time).count();
+  result.bytes_sent = sent * sizeof(tuple<int64_t, int64_t>);
+  result.bytes_received = total_received * sizeof(tuple<int64_t, int64_t>);
+  result.key_sum = 0;
+  result.misplaced = 0;
+  for (const auto &item : received)
+  {
+    result.key_sum += get<0>(item);
+    result.misplaced += get_partition(get<0>(item), num_of_buckets) % num_of_processes != process;
+  }
+  wait_for_all(segment.header().shuffled, num_of_processes);
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [num_of_processes] [ring_size]" << endl;
+  cout << "Example: " << program_name << " 2 8 16777216 metrics.csv 0 4 65536" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used per process.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param num_of_processes The number of worker processes.
+ * @param ring_size The number of tuples per ring buffer.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  int num_of_processes, int ring_size)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads per process: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tNumber of processes: " << num_of_processes << endl;
+  cout << "\tRing size: " << ring_size << " tuples" << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc < 6 || argc > 8)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  int num_of_processes = argc >= 7 ? stoi(argv[6]) : 4;
+  int ring_size = argc >= 8 ? stoi(argv[7]) : 65536;
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+  if (num_of_processes < 1 || num_of_processes > MAX_PROCESSES || ring_size < 1 || (ring_size & (ring_size - 1)) != 0)
+  {
+    cerr << "Error: The number of processes must be between 1 and " << MAX_PROCESSES << " and the ring size a power of two" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, num_of_processes, ring_size);
+
+  // One shared memory object for the control block and all rings, inherited by the workers
+  string shm_name = "/partition-shuffle-" + to_string(getpid());
+  size_t shm_size = ShuffleSegment::size(num_of_processes, ring_size);
+  int fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 || ftruncate(fd, shm_size) != 0)
+  {
+    cerr << "Error: Unable to create shared memory object: " << shm_name << endl;
+    if (fd >= 0)
+    {
+      close(fd);
+      shm_unlink(shm_name.c_str());
+    }
+    return 1;
+  }
+  char *base = (char *)mmap(nullptr, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  shm_unlink(shm_name.c_str());
+  if (base == MAP_FAILED)
+  {
+    cerr << "Error: Unable to map shared memory object: " << shm_name << endl;
+    return 1;
+  }
+  // The object is zero-filled, which is the initial state of the counters and the rings
+  ShuffleSegment segment(base, num_of_processes, ring_size);
+
+  vector<pid_t> workers;
+  for (int p = 0; p < num_of_processes; p++)
+  {
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      run_worker(segment, p, num_of_processes, num_of_threads, num_of_buckets, data_size);
+      _exit(0);
+    }
+    workers.push_back(pid);
+  }
+  // Reap the workers as they exit. The others would wait forever at a barrier for a worker that failed, so kill them.
+  bool workers_ok = true;
+  while (!workers.empty())
+  {
+    int status = 0;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0)
+    {
+      workers_ok = false;
+      break;
+    }
+    workers.erase(remove(workers.begin(), workers.end(), pid), workers.end());
+    if (workers_ok && !(WIFEXITED(status) && WEXITSTATUS(status) == 0))
+    {
+      workers_ok = false;
+      for (pid_t worker : workers)
+      {
+        kill(worker, SIGKILL);
+      }
+    }
+  }
+
+  if (!workers_ok)
+  {
+    cerr << "Error: A worker process failed" << endl;
+    munmap(base, shm_size);
+    return 1;
+  }
+
+  cout << fixed << setprecision(2);
+  int64_t key_sum = 0;
+  int64_t misplaced = 0;
+  // The shuffle runs from the first process leaving the start barrier to the last process done shuffling
+  int64_t start_ns = segment.result(0).start_ns; // ------------------------ START TIME ------------------------
+  int64_t end_ns = segment.result(0).end_ns;     // ------------------------ END TIME ------------------------
+  for (int p = 0; p < num_of_processes; p++)
+  {
+    start_ns = min(start_ns, segment.result(p).start_ns);
+    end_ns = max(end_ns, segment.result(p).end_ns);
+    const ProcessResult &result = segment.result(p);
+    cout << "Process " << p << ": partition " << result.partition_ms << " ms, shuffle " << result.shuffle_ms
+         << " ms, sent " << result.bytes_sent / 1e6 << " MB (" << result.bytes_sent / 1e3 / max(1e-3, result.shuffle_ms)
+         << " MB/s), received " << result.bytes_received / 1e6 << " MB ("
+         << result.bytes_received / 1e3 / max(1e-3, result.shuffle_ms) << " MB/s)" << endl;
+    key_sum += result.key_sum;
+    misplaced += result.misplaced;
+  }
+  auto duration = duration_cast<milliseconds>(nanoseconds(end_ns - start_ns));
+  cout << "End-to-end shuffle: " << (end_ns - start_ns) / 1e6 << " ms" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    bool verified = misplaced == 0 && key_sum == (int64_t)data_size * (data_size + 1) / 2;
+    cout << "Output verified: " << (verified ? "yes" : "NO") << endl;
+  }
+  munmap(base, shm_size);
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, PROGRAM_NAME + "-" + to_string(num_of_processes), num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
@@ -0,0 +1,679 @@
+/**
+ * This program collects statistics of every partition while the tuples are scattered.
+ * For every bucket it keeps the exact count, the smallest and the largest key, a HyperLogLog sketch estimating the
+ * number of distinct keys and a Misra-Gries sketch of the most frequent keys. Every thread updates its own statistics
+ * in the scatter loop, while the tuple is in registers anyway, and the copies of the threads are merged in parallel at
+ * the end. The same data is also partitioned without statistics, so the cost of collecting them can be measured.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param hot_percent (optional) The percentage of tuples whose key is replaced by one of 16 hot keys, 0 to 100.
+ *        Defaults to 0.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "stats-partition";
+const string WITHOUT_STATS_PROGRAM_NAME = "partition-without-stats";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// The HyperLogLog sketch of a bucket has 2^HLL_PRECISION one-byte registers
+const int HLL_PRECISION = 6;
+const int HLL_REGISTERS = 1 << HLL_PRECISION;
+
+// Number of counters of the Misra-Gries sketch of a bucket
+const int HEAVY_HITTERS = 4;
+
+// Upper bound of the memory of the per-thread statistics. Above it, a sketch covers several buckets.
+const long STATS_MEMORY_BUDGET = 64L << 20;
+
+// Number of distinct hot keys when part of the data is skewed
+const int NUM_OF_HOT_KEYS = 16;
+
+/**
+ * The statistics of a bucket, 152 bytes.
+ */
+struct PartitionStats
+{
+  int64_t count;
+  int64_t min_key;
+  int64_t max_key;
+  uint8_t registers[HLL_REGISTERS];
+  int64_t hitter_keys[HEAVY_HITTERS];
+  int64_t hitter_counts[HEAVY_HITTERS];
+
+  PartitionStats() : count(0), min_key(numeric_limits<int64_t>::max()), max_key(numeric_limits<int64_t>::min())
+  {
+    fill(registers, registers + HLL_REGISTERS, 0);
+    fill(hitter_keys, hitter_keys + HEAVY_HITTERS, 0);
+    fill(hitter_counts, hitter_counts + HEAVY_HITTERS, 0);
+  }
+};
+
+/**
+ * Get the data given a number. A percentage of the tuples get one of a few hot keys instead of their own.
+ * @param n The number to get the data for.
+ * @param hot_percent The percentage of tuples with a hot key.
+ * @return The data for the number.
+ */
+vector<tuple<int64_t, int64_t>> get_data_given_n(int n, int hot_percent)
+{
+  vector<tuple<int64_t, int64_t>> data(n);
+  for (int64_t i = 0; i < n; i++)
+  {
+    bool hot = (uint64_t)i * 2654435761ULL % 100 < (uint64_t)hot_percent;
+    data[i] = tuple<int64_t, int64_t>(hot ? i % NUM_OF_HOT_KEYS + 1 : i + 1, i + 1);
+  }
+  return data;
+}
+
+/**
+ * Get the partition for a number.
+ * @param n The number to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the number.
+ */
+int get_partition(int64_t n, int num_of_buckets)
+{
+  return n % num_of_buckets;
+}
+
+/**
+ * Compute the number of statistics per thread so that the copies of all threads stay within the memory budget.
+ * The number is a power of two, so statistics s covers the buckets b with b % num_of_sketches == s.
+ * @param num_of_threads The number of threads.
+ * @param num_of_buckets The number of buckets.
+ * @return The number of statistics per thread.
+ */
+int compute_num_of_sketches(int num_of_threads, int num_of_buckets)
+{
+  int num_of_sketches = num_of_buckets;
+  while (num_of_sketches > 1 && (long)num_of_threads * num_of_sketches * sizeof(PartitionStats) > STATS_MEMORY_BUDGET)
+  {
+    num_of_sketches /= 2;
+  }
+  return num_of_sketches;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Mix the bits of a key for the HyperLogLog sketch. The keys of a bucket share their low bits, so they are hashed first.
+ * @param key The key to hash.
+ * @return The hash of the key.
+ */
+uint64_t hash_key(int64_t key)
+{
+  uint64_t h = key;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/**
+ * Add a key to the statistics of a bucket.
+ * @param stats The statistics of the bucket.
+ * @param key The key to add.
+ */
+void add_key(PartitionStats &stats, int64_t key)
+{
+  stats.count++;
+  stats.min_key = min(stats.min_key, key);
+  stats.max_key = max(stats.max_key, key);
+
+  uint64_t h = hash_key(key);
+  uint64_t rest = h << HLL_PRECISION;
+  uint8_t rank = rest ? __builtin_clzll(rest) + 1 : 64 - HLL_PRECISION + 1;
+  uint8_t &reg = stats.registers[h >> (64 - HLL_PRECISION)];
+  reg = max(reg, rank);
+
+  // Misra-Gries: count the key if it has a counter, else take a free counter, else decrement all counters
+  for (int i = 0; i < HEAVY_HITTERS; i++)
+  {
+    if (stats.hitter_counts[i] > 0 && stats.hitter_keys[i] == key)
+    {
+      stats.hitter_counts[i]++;
+      return;
+    }
+  }
+  for (int i = 0; i < HEAVY_HITTERS; i++)
+  {
+    if (stats.hitter_counts[i] == 0)
+    {
+      stats.hitter_keys[i] = key;
+      stats.hitter_counts[i] = 1;
+      return;
+    }
+  }
+  for (int i = 0; i < HEAVY_HITTERS; i++)
+  {
+    stats.hitter_counts[i]--;
+  }
+}
+
+/**
+ * Merge the statistics of a bucket collected by another thread.
+ * @param into The statistics to merge into.
+ * @param from The statistics to merge.
+ */
+void merge_stats(PartitionStats &into, const PartitionStats &from)
+{
+  into.count += from.count;
+  into.min_key = min(into.min_key, from.min_key);
+  into.max_key = max(into.max_key, from.max_key);
+  for (int i = 0; i < HLL_REGISTERS; i++)
+  {
+    into.registers[i] = max(into.registers[i], from.registers[i]);
+  }
+
+  // Add up the counters of both sketches, then keep the largest ones minus the first one that does not fit. Unused
+  // counters stay zero and sort last, so the whole array is sorted.
+  array<pair<int64_t, int64_t>, 2 * HEAVY_HITTERS> counters{};
+  int num_of_counters = 0;
+  for (int i = 0; i < HEAVY_HITTERS; i++)
+  {
+    if (into.hitter_counts[i] > 0)
+    {
+      counters[num_of_counters++] = make_pair(into.hitter_counts[i], into.hitter_keys[i]);
+    }
+  }
+  for (int i = 0; i < HEAVY_HITTERS; i++)
+  {
+    if (from.hitter_counts[i] == 0)
+    {
+      continue;
+    }
+    int j = 0;
+    while (j < num_of_counters && counters[j].second != from.hitter_keys[i])
+    {
+      j++;
+    }
+    if (j < num_of_counters)
+    {
+      counters[j].first += from.hitter_counts[i];
+    }
+    else
+    {
+      counters[num_of_counters++] = make_pair(from.hitter_counts[i], from.hitter_keys[i]);
+    }
+  }
+  sort(counters.begin(), counters.end(), greater<pair<int64_t, int64_t>>());
+  int64_t cut = counters[HEAVY_HITTERS].first;
+  for (int i = 0; i < HEAVY_HITTERS; i++)
+  {
+    bool kept = i < num_of_counters && counters[i].first > cut;
+    into.hitter_keys[i] = kept ? counters[i].second : 0;
+    into.hitter_counts[i] = kept ? counters[i].first - cut : 0;
+  }
+}
+
+/**
+ * Estimate the number of distinct keys of a bucket from its HyperLogLog sketch.
+ * @param stats The statistics of the bucket.
+ * @return The estimated number of distinct keys.
+ */
+double estimate_distinct(const PartitionStats &stats)
+{
+  double sum = 0;
+  int zeros = 0;
+  for (int i = 0; i < HLL_REGISTERS; i++)
+  {
+    sum += ldexp(1.0, -stats.registers[i]);
+    zeros += stats.registers[i] == 0;
+  }
+  double estimate = 0.709 * HLL_REGISTERS * HLL_REGISTERS / sum;
+  // Small range correction: count the empty registers instead
+  if (estimate <= 2.5 * HLL_REGISTERS && zeros > 0)
+  {
+    estimate = HLL_REGISTERS * log((double)HLL_REGISTERS / zeros);
+  }
+  return estimate;
+}
+
+/**
+ * Count the number of tuples per bucket for a chunk.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_buckets The number of buckets.
+ * @param histogram The histogram of the thread.
+ */
+void count_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                 vector<int> &histogram)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    histogram[get_partition(get<0>(data[j]), num_of_buckets)]++;
+  }
+}
+
+/**
+ * Scatter a chunk.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param offsets The write offsets of the thread.
+ * @param output The output to scatter to.
+ */
+void scatter_chunk(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data, int num_of_buckets,
+                   vector<int> &offsets, vector<tuple<int64_t, int64_t>> &output)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    output[offsets[get_partition(get<0>(data[j]), num_of_buckets)]++] = data[j];
+  }
+}
+
+/**
+ * Scatter a chunk and add every key to the statistics of its bucket.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param offsets The write offsets of the thread.
+ * @param output The output to scatter to.
+ * @param stats The statistics of the thread, one per group of buckets.
+ */
+void scatter_chunk_with_stats(int thread_id, int start, int end, const vector<tuple<int64_t, int64_t>> &data,
+                              int num_of_buckets, vector<int> &offsets, vector<tuple<int64_t, int64_t>> &output,
+                              vector<PartitionStats> &stats)
+{
+  pin_thread(thread_id);
+  int sketch_mask = stats.size() - 1;
+  for (int j = start; j < end; j++)
+  {
+    int64_t key = get<0>(data[j]);
+    int partition = get_partition(key, num_of_buckets);
+    output[offsets[partition]++] = data[j];
+    add_key(stats[partition & sketch_mask], key);
+  }
+}
+
+/**
+ * Merge the statistics of all threads into those of the first thread for a range of statistics.
+ * @param thread_id The id of the thread.
+ * @param start The first statistics.
+ * @param end The end of the statistics.
+ * @param stats The statistics of every thread.
+ */
+void merge_chunk(int thread_id, int start, int end, vector<vector<PartitionStats>> &stats)
+{
+  pin_thread(thread_id);
+  for (int b = start; b < end; b++)
+  {
+    for (size_t i = 1; i < stats.size(); i++)
+    {
+      merge_stats(stats[0][b], stats[i][b]);
+    }
+  }
+}
+
+/**
+ * Partition the data with a count pass and a scatter pass, optionally collecting statistics.
+ * @param data The data to partition.
+ * @param num_of_threads The number of threads.
+ * @param num_of_buckets The number of buckets.
+ * @param output The partitioned data.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ * @param stats The statistics of every thread (a power of two per thread, at most one per bucket), merged into the
+ * first, or nullptr to not collect statistics.
+ */
+void run_partitioning(const vector<tuple<int64_t, int64_t>> &data, int num_of_threads, int num_of_buckets,
+                      vector<tuple<int64_t, int64_t>> &output, vector<int> &bucket_start,
+                      vector<vector<PartitionStats>> *stats)
+{
+  int data_size = data.size();
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+
+  vector<thread> threads;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, i, start, end, cref(data), num_of_buckets, ref(histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  int offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    bucket_start[b] = offset;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+    }
+  }
+  bucket_start[num_of_buckets] = offset;
+
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    if (stats)
+    {
+      threads.push_back(thread(scatter_chunk_with_stats, i, start, end, cref(data), num_of_buckets,
+                               ref(histograms[i]), ref(output), ref((*stats)[i])));
+    }
+    else
+    {
+      threads.push_back(thread(scatter_chunk, i, start, end, cref(data), num_of_buckets, ref(histograms[i]),
+                               ref(output)));
+    }
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  if (stats)
+  {
+    int num_of_sketches = (*stats)[0].size();
+    int sketch_chunk_size = compute_input_chunk_size(num_of_sketches, num_of_threads);
+    threads.clear();
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int start = i * sketch_chunk_size;
+      int end = (i == num_of_threads - 1) ? num_of_sketches : start + sketch_chunk_size;
+      threads.push_back(thread(merge_chunk, i, start, end, ref(*stats)));
+    }
+    for (auto &t : threads)
+    {
+      t.join();
+    }
+  }
+}
+
+/**
+ * Check the exact statistics against a scan of the buckets and measure the error of the distinct estimates.
+ * @param output The partitioned data.
+ * @param bucket_start The first tuple of every bucket, followed by the data size.
+ * @param num_of_buckets The number of buckets.
+ * @param stats The merged statistics, one per group of buckets.
+ * @param distinct_error The mean relative error of the distinct estimates.
+ * @return Whether the exact statistics are correct.
+ */
+bool verify_output(const vector<tuple<int64_t, int64_t>> &output, const vector<int> &bucket_start, int num_of_buckets,
+                   const vector<PartitionStats> &stats, double &distinct_error)
+{
+  int num_of_sketches = stats.size();
+  vector<vector<int64_t>> keys(num_of_sketches);
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    for (int j = bucket_start[b]; j < bucket_start[b + 1]; j++)
+    {
+      if (get_partition(get<0>(output[j]), num_of_buckets) != b)
+      {
+        return false;
+      }
+      keys[b % num_of_sketches].push_back(get<0>(output[j]));
+    }
+  }
+
+  distinct_error = 0;
+  int non_empty = 0;
+  for (int s = 0; s < num_of_sketches; s++)
+  {
+    if (stats[s].count != (int64_t)keys[s].size())
+    {
+      return false;
+    }
+    if (keys[s].empty())
+    {
+      continue;
+    }
+    sort(keys[s].begin(), keys[s].end());
+    if (stats[s].min_key != keys[s].front() || stats[s].max_key != keys[s].back())
+    {
+      return false;
+    }
+    double distinct = unique(keys[s].begin(), keys[s].end()) - keys[s].begin();
+    distinct_error += fabs(estimate_distinct(stats[s]) - distinct) / distinct;
+    non_empty++;
+  }
+  distinct_error /= max(1, non_empty);
+  return true;
+}
+
+/**
+ * Print the first statistics.
+ * @param stats The merged statistics, one per group of buckets.
+ * @param num_of_buckets The number of buckets to use.
+ */
+void print_output(const vector<PartitionStats> &stats, int num_of_buckets)
+{
+  int num_of_sketches = stats.size();
+  int buckets_per_sketch = num_of_buckets / num_of_sketches;
+  cout << "Statistics (first 16 of " << num_of_sketches << ", " << buckets_per_sketch << " partitions each): " << endl;
+  for (int b = 0; b < min(num_of_sketches, 16); b++)
+  {
+    cout << "Partition " << b;
+    if (buckets_per_sketch > 1)
+    {
+      cout << " (mod " << num_of_sketches << ")";
+    }
+    cout << ": count " << stats[b].count;
+    if (stats[b].count > 0)
+    {
+      cout << ", keys " << stats[b].min_key << ".." << stats[b].max_key << ", ~" << (long)estimate_distinct(stats[b])
+           << " distinct, frequent:";
+      for (int i = 0; i < HEAVY_HITTERS; i++)
+      {
+        if (stats[b].hitter_counts[i] > 0)
+        {
+          cout << " " << stats[b].hitter_keys[i] << "(>=" << stats[b].hitter_counts[i] << ")";
+        }
+      }
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [hot_percent]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 0" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param hot_percent The percentage of tuples with a hot key.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  int hot_percent)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tHot keys: " << hot_percent << "%" << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc != 6 && argc != 7)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  int hot_percent = argc == 7 ? stoi(argv[6]) : 0;
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+  if (hot_percent < 0 || hot_percent > 100)
+  {
+    cerr << "Error: The percentage of hot keys must be between 0 and 100" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, hot_percent);
+
+  auto data = get_data_given_n(data_size, hot_percent);
+  vector<tuple<int64_t, int64_t>> output(data_size);
+  vector<int> bucket_start(num_of_buckets + 1);
+
+  // Partition without statistics first
+  auto plain_start_time = high_resolution_clock::now();
+  run_partitioning(data, num_of_threads, num_of_buckets, output, bucket_start, nullptr);
+  auto plain_end_time = high_resolution_clock::now();
+  auto plain_duration = duration_cast<milliseconds>(plain_end_time - plain_start_time);
+
+  int num_of_sketches = compute_num_of_sketches(num_of_threads, num_of_buckets);
+  vector<vector<PartitionStats>> stats(num_of_threads, vector<PartitionStats>(num_of_sketches));
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+
+  run_partitioning(data, num_of_threads, num_of_buckets, output, bucket_start, &stats);
+
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  double plain_ms = chrono::duration<double, milli>(plain_end_time - plain_start_time).count();
+  double stats_ms = chrono::duration<double, milli>(end_time - start_time).count();
+  cout << fixed << setprecision(2);
+  cout << "Without statistics: " << plain_ms << " ms" << endl;
+  cout << "With statistics: " << stats_ms << " ms (" << 100.0 * (stats_ms - plain_ms) / plain_ms << "% overhead)" << endl;
+  cout << "Statistics memory: " << (double)num_of_threads * num_of_sketches * sizeof(PartitionStats) / 1e6 << " MB ("
+       << num_of_sketches << " statistics per thread)" << endl;
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    double distinct_error = 0;
+    bool verified = verify_output(output, bucket_start, num_of_buckets, stats[0], distinct_error);
+    cout << "Output verified: " << (verified ? "yes" : "NO") << endl;
+    cout << "Mean distinct estimate error: " << 100 * distinct_error << "%" << endl;
+    print_output(stats[0], num_of_buckets);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename
+  append_metrics_to_csv(filename, PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+  append_metrics_to_csv(filename, WITHOUT_STATS_PROGRAM_NAME, num_of_threads, num_of_hashbits, num_of_buckets, data_size, plain_duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
@@ -0,0 +1,467 @@
+/**
+ * This program partitions tuples with variable-length string keys.
+ * The keys are stored as one byte heap plus an offset array, so there is no allocation per key. The first pass hashes
+ * the key bytes and counts the tuples and key bytes per bucket, the second pass scatters fixed-size entries holding
+ * the hash, the payload and the offset and length of the key in the heap. Optionally a third pass materializes the
+ * key bytes of every bucket contiguously, so a bucket can be read without jumping around in the original heap.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file to append metrics to.
+ * @param debug The debug flag to print debug information.
+ * @param materialize (optional) 1 to copy the key bytes contiguously per bucket, 0 to only partition the entries.
+ *        Defaults to 1.
+ * @return The exit status of the program. Will write to the CSV file.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <pthread.h>
+#include <iomanip>
+#include <sys/sysinfo.h>
+
+using namespace std;
+using namespace std::chrono;
+
+const string PROGRAM_NAME = "string-partition";
+
+// Define a maximum number of buckets
+const int MAX_BUCKETS = 1 << 18;
+
+// Prefix of every generated key, so the keys are longer than a single integer
+const string KEY_PREFIX = "key-";
+
+/**
+ * The input: all key bytes in one heap, key i being heap[offsets[i]] to heap[offsets[i + 1] - 1].
+ */
+struct StringData
+{
+  vector<char> heap;
+  vector<int64_t> offsets;
+  vector<int64_t> payloads;
+};
+
+/**
+ * A fixed-size partitioned entry. The key is not copied, only its position in a heap.
+ */
+struct StringEntry
+{
+  uint64_t hash;
+  int64_t payload;
+  int64_t offset;
+  int64_t length;
+};
+
+/**
+ * Get the data given a number. Key i is KEY_PREFIX followed by i + 1, so the keys have different lengths.
+ * @param n The number to get the data for.
+ * @return The data for the number.
+ */
+StringData get_data_given_n(int n)
+{
+  StringData data;
+  data.offsets.resize(n + 1);
+  data.payloads.resize(n);
+  data.heap.reserve((int64_t)n * (KEY_PREFIX.size() + 8));
+  for (int64_t i = 0; i < n; i++)
+  {
+    data.offsets[i] = data.heap.size();
+    string key = KEY_PREFIX + to_string(i + 1);
+    data.heap.insert(data.heap.end(), key.begin(), key.end());
+    data.payloads[i] = i + 1;
+  }
+  data.offsets[n] = data.heap.size();
+  return data;
+}
+
+/**
+ * Hash the bytes of a key with 64-bit FNV-1a.
+ * @param bytes The bytes of the key.
+ * @param length The length of the key.
+ * @return The hash of the key.
+ */
+uint64_t hash_bytes(const char *bytes, int64_t length)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (int64_t i = 0; i < length; i++)
+  {
+    hash ^= (unsigned char)bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * Get the partition for a hash.
+ * @param hash The hash to get the partition for.
+ * @param num_of_buckets The number of buckets to use.
+ * @return The partition for the hash.
+ */
+int get_partition(uint64_t hash, int num_of_buckets)
+{
+  return hash % num_of_buckets;
+}
+
+/**
+ * Compute the chunk size for each thread.
+ * @param data_size The size of the data.
+ * @param num_of_threads The number of threads
+ * @return The chunk size for each thread to take.
+ */
+int compute_input_chunk_size(int data_size, int num_of_threads)
+{
+  return data_size / num_of_threads;
+}
+
+/**
+ * Set the affinity of the calling thread to a specific CPU core.
+ * @param thread_id The id of the thread.
+ */
+void pin_thread(int thread_id)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  // Use modulo in case we have more threads than cores
+  CPU_SET(thread_id % thread::hardware_concurrency(), &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * Hash the keys of a chunk and count the tuples and key bytes per bucket.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to count.
+ * @param num_of_buckets The number of buckets.
+ * @param hashes The hash of every key.
+ * @param histogram The number of tuples per bucket of the thread.
+ * @param byte_histogram The number of key bytes per bucket of the thread.
+ */
+void count_chunk(int thread_id, int start, int end, const StringData &data, int num_of_buckets,
+                 vector<uint64_t> &hashes, vector<int> &histogram, vector<int64_t> &byte_histogram)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    int64_t length = data.offsets[j + 1] - data.offsets[j];
+    hashes[j] = hash_bytes(&data.heap[data.offsets[j]], length);
+    int partition = get_partition(hashes[j], num_of_buckets);
+    histogram[partition]++;
+    byte_histogram[partition] += length;
+  }
+}
+
+/**
+ * Scatter the entries of a chunk. Only the fixed-size entries are moved, the key bytes stay in the heap.
+ * @param thread_id The id of the thread.
+ * @param start The start index of the chunk.
+ * @param end The end index of the chunk.
+ * @param data The data to scatter.
+ * @param num_of_buckets The number of buckets.
+ * @param hashes The hash of every key.
+ * @param offsets The write offsets of the thread.
+ * @param entries The entries to scatter to.
+ */
+void scatter_chunk(int thread_id, int start, int end, const StringData &data, int num_of_buckets,
+                   const vector<uint64_t> &hashes, vector<int> &offsets, vector<StringEntry> &entries)
+{
+  pin_thread(thread_id);
+  for (int j = start; j < end; j++)
+  {
+    StringEntry &entry = entries[offsets[get_partition(hashes[j], num_of_buckets)]++];
+    entry.hash = hashes[j];
+    entry.payload = data.payloads[j];
+    entry.offset = data.offsets[j];
+    entry.length = data.offsets[j + 1] - data.offsets[j];
+  }
+}
+
+/**
+ * Copy the key bytes of whole buckets contiguously into a new heap and point the entries at the copies.
+ * Buckets are handed out to the threads dynamically.
+ * @param thread_id The id of the thread.
+ * @param next_bucket The next bucket to materialize, shared by all threads.
+ * @param num_of_buckets The number of buckets.
+ * @param data The data with the original heap.
+ * @param bucket_start The first entry of every bucket, followed by the data size.
+ * @param bucket_byte_start The first byte of every bucket in the new heap.
+ * @param entries The partitioned entries.
+ * @param heap The new heap.
+ */
+void materialize_buckets(int thread_id, atomic<int> &next_bucket, int num_of_buckets, const StringData &data,
+                         const vector<int> &bucket_start, const vector<int64_t> &bucket_byte_start,
+                         vector<StringEntry> &entries, vector<char> &heap)
+{
+  pin_thread(thread_id);
+  for (int b = next_bucket++; b < num_of_buckets; b = next_bucket++)
+  {
+    int64_t offset = bucket_byte_start[b];
+    for (int j = bucket_start[b]; j < bucket_start[b + 1]; j++)
+    {
+      memcpy(&heap[offset], &data.heap[entries[j].offset], entries[j].length);
+      entries[j].offset = offset;
+      offset += entries[j].length;
+    }
+  }
+}
+
+/**
+ * Check that every entry is in the bucket of its key and points at the right key.
+ * @param entries The partitioned entries.
+ * @param heap The heap the entries point into.
+ * @param bucket_start The first entry of every bucket, followed by the data size.
+ * @param num_of_buckets The number of buckets.
+ * @param data_size The size of the data.
+ * @return Whether the partitioning is correct.
+ */
+bool verify_output(const vector<StringEntry> &entries, const vector<char> &heap, const vector<int> &bucket_start,
+                   int num_of_buckets, int data_size)
+{
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    for (int j = bucket_start[b]; j < bucket_start[b + 1]; j++)
+    {
+      const StringEntry &entry = entries[j];
+      string key(&heap[entry.offset], entry.length);
+      if (get_partition(hash_bytes(key.data(), key.size()), num_of_buckets) != b ||
+          key != KEY_PREFIX + to_string(entry.payload))
+      {
+        return false;
+      }
+    }
+  }
+  return bucket_start[num_of_buckets] == data_size;
+}
+
+/**
+ * Print the output vector.
+ * @param entries The partitioned entries.
+ * @param heap The heap the entries point into.
+ * @param bucket_start The first entry of every bucket, followed by the data size.
+ * @param num_of_buckets The number of buckets to use.
+ */
+void print_output(const vector<StringEntry> &entries, const vector<char> &heap, const vector<int> &bucket_start,
+                  int num_of_buckets)
+{
+  cout << "Data (first 10 elements from each partition): " << endl;
+  for (int b = 0; b < min(num_of_buckets, 16); b++)
+  {
+    cout << "Partition " << b << " (size: " << bucket_start[b + 1] - bucket_start[b] << "): ";
+    for (int j = bucket_start[b]; j < min(bucket_start[b] + 10, bucket_start[b + 1]); j++)
+    {
+      cout << "(" << string(&heap[entries[j].offset], entries[j].length) << "," << entries[j].payload << ") ";
+    }
+    cout << endl;
+  }
+}
+
+/**
+ * Print the usage of the program.
+ * @param program_name The name of the program.
+ */
+void print_usage(const char *program_name)
+{
+  cout << "Usage: " << program_name << " <num_of_threads> <num_of_hashbits> <data_size> <filename> <debug> [materialize]" << endl;
+  cout << "Example: " << program_name << " 8 8 16777216 metrics.csv 0 1" << endl;
+}
+
+/**
+ * Print the parameters of the program.
+ * @param program_name The name of the program.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param filename The name of the CSV file.
+ * @param debug The debug flag.
+ * @param materialize Whether the key bytes are materialized per bucket.
+ */
+void print_params(const char *program_name, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, const string &filename, bool debug,
+                  bool materialize)
+{
+  cout << "Running " << program_name << " with the following parameters:" << endl;
+  cout << "\tNumber of threads: " << num_of_threads << endl;
+  cout << "\tNumber of hash bits: " << num_of_hashbits << endl;
+  cout << "\tNumber of buckets: " << num_of_buckets << endl;
+  cout << "\tData size: " << data_size << endl;
+  cout << "\tOutput file: " << filename << endl;
+  cout << "\tDebug flag: " << debug << endl;
+  cout << "\tMaterialize keys: " << materialize << endl;
+}
+
+/**
+ * Append performance metrics to a CSV file.
+ * @param filename The name of the CSV file.
+ * @param algorithm The name of the algorithm to record the metrics under.
+ * @param num_of_threads The number of threads used.
+ * @param num_of_hashbits The number of hash bits used.
+ * @param num_of_buckets The number of buckets used.
+ * @param data_size The size of the data used.
+ * @param duration The duration of the computation.
+ * @param num_cores The number of CPU cores used.
+ * @param memory_used The amount of memory used.
+ */
+void append_metrics_to_csv(const string &filename, const string &algorithm, int num_of_threads, int num_of_hashbits, int num_of_buckets, int data_size, double duration, int num_cores, long memory_used)
+{
+  ofstream file;
+  // open file on linux
+  file.open(filename, ios_base::app);
+  if (file.is_open())
+  {
+    file << algorithm << ","
+         << num_of_threads << ","
+         << num_of_hashbits << ","
+         << num_of_buckets << ","
+         << data_size << ","
+         << duration << ","
+         << num_cores << ","
+         << memory_used << endl;
+    file.close();
+  }
+  else
+  {
+    cerr << "Unable to open file: " << filename << endl;
+  }
+}
+
+/**
+ * Main function to run the program.
+ * @return The exit status of the program.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc != 6 && argc != 7)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int num_of_threads = stoi(argv[1]);
+  int num_of_hashbits = stoi(argv[2]);
+  int data_size = stoi(argv[3]);
+  string filename = argv[4];
+  bool debug = stoi(argv[5]);
+  bool materialize = argc == 7 ? stoi(argv[6]) : true;
+
+  int num_of_buckets = 1 << num_of_hashbits;
+  if (num_of_buckets > MAX_BUCKETS)
+  {
+    cerr << "Error: Number of buckets exceeds maximum supported (" << MAX_BUCKETS << ")" << endl;
+    return 1;
+  }
+
+  print_params(argv[0], num_of_threads, num_of_hashbits, num_of_buckets, data_size, filename, debug, materialize);
+
+  StringData data = get_data_given_n(data_size);
+  int chunk_size = compute_input_chunk_size(data_size, num_of_threads);
+
+  vector<thread> threads;
+  vector<uint64_t> hashes(data_size);
+  vector<vector<int>> histograms(num_of_threads, vector<int>(num_of_buckets, 0));
+  vector<vector<int64_t>> byte_histograms(num_of_threads, vector<int64_t>(num_of_buckets, 0));
+  vector<StringEntry> entries(data_size);
+  vector<int> bucket_start(num_of_buckets + 1);
+  vector<int64_t> bucket_byte_start(num_of_buckets + 1);
+  vector<char> heap;
+
+  auto start_time = high_resolution_clock::now(); // ------------------------ START TIME ------------------------
+
+  // First pass: hash the keys and count the tuples and bytes per bucket
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(count_chunk, i, start, end, cref(data), num_of_buckets, ref(hashes), ref(histograms[i]),
+                             ref(byte_histograms[i])));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  int offset = 0;
+  int64_t byte_offset = 0;
+  for (int b = 0; b < num_of_buckets; b++)
+  {
+    bucket_start[b] = offset;
+    bucket_byte_start[b] = byte_offset;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      int count = histograms[i][b];
+      histograms[i][b] = offset;
+      offset += count;
+      byte_offset += byte_histograms[i][b];
+    }
+  }
+  bucket_start[num_of_buckets] = offset;
+  bucket_byte_start[num_of_buckets] = byte_offset;
+
+  // Second pass: scatter the fixed-size entries
+  threads.clear();
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    int start = i * chunk_size;
+    int end = (i == num_of_threads - 1) ? data_size : start + chunk_size;
+    threads.push_back(thread(scatter_chunk, i, start, end, cref(data), num_of_buckets, cref(hashes), ref(histograms[i]),
+                             ref(entries)));
+  }
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+
+  auto scatter_time = high_resolution_clock::now();
+
+  // Optional third pass: copy the key bytes of every bucket contiguously
+  if (materialize)
+  {
+    heap.resize(byte_offset);
+    atomic<int> next_bucket(0);
+    threads.clear();
+    for (int i = 0; i < num_of_threads; i++)
+    {
+      threads.push_back(thread(materialize_buckets, i, ref(next_bucket), num_of_buckets, cref(data), cref(bucket_start),
+                               cref(bucket_byte_start), ref(entries), ref(heap)));
+    }
+    for (auto &t : threads)
+    {
+      t.join();
+    }
+  }
+
+  auto end_time = high_resolution_clock::now(); // ------------------------ END TIME ------------------------
+  auto duration = duration_cast<milliseconds>(end_time - start_time);
+
+  cout << fixed << setprecision(2);
+  cout << "Key bytes: " << byte_offset / 1e6 << " MB (" << (double)byte_offset / max(1, data_size) << " bytes per key)" << endl;
+  cout << "Partitioning: " << chrono::duration<double, milli>(scatter_time - start_time).count() << " ms" << endl;
+  if (materialize)
+  {
+    cout << "Materializing: " << chrono::duration<double, milli>(end_time - scatter_time).count() << " ms" << endl;
+  }
+  cout.unsetf(ios_base::floatfield);
+
+  if (debug)
+  {
+    const vector<char> &entry_heap = materialize ? heap : data.heap;
+    cout << "Output verified: " << (verify_output(entries, entry_heap, bucket_start, num_of_buckets, data_size) ? "yes" : "NO") << endl;
+    print_output(entries, entry_heap, bucket_start, num_of_buckets);
+  }
+
+  struct sysinfo memInfo;
+  sysinfo(&memInfo);
+  long memory_used = memInfo.totalram - memInfo.freeram;
+
+  // Append metrics to CSV file using the provided filename, the materialize pass is part of the duration
+  string algorithm = materialize ? PROGRAM_NAME + "-materialize" : PROGRAM_NAME;
+  append_metrics_to_csv(filename, algorithm, num_of_threads, num_of_hashbits, num_of_buckets, data_size, duration.count(), thread::hardware_concurrency(), memory_used);
+
+  return 0;
+}
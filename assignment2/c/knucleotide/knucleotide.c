@@ -7,10 +7,19 @@
 // and each oligonucleotide count output by this program.
 #define MAXIMUM_OUTPUT_LENGTH 4096
 
+// Needed for memmem().
+#define _GNU_SOURCE
+
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <omp.h>
 
 #include <khash.h>
 
@@ -44,6 +53,25 @@ typedef struct {
 #define nucleotide_For_Code(code) ("ACGT"[code & 0x3])
 
 
+// The polynucleotide is stored packed with 2 bits per nucleotide, 4 per byte,
+// in an array of 64 bit words. The first nucleotide in each word is stored in
+// the most significant bits so that the bits of consecutive words read in
+// order match the bits of a key for the same nucleotides.
+#define NUCLEOTIDES_PER_WORD 32
+
+
+// Get the keys for the oligonucleotides ending at each of the nucleotides in
+// word and save them to keys. Each key holds the last NUCLEOTIDES_PER_WORD
+// nucleotides (some of which come from previous_Word) and the key for any
+// shorter length is just the low bits of it. Every key is computed
+// independently with just shifts so that the compiler can vectorize this.
+static inline void get_Oligonucleotide_Keys(const uint64_t previous_Word
+  , const uint64_t word, uint64_t * const keys){
+	for(intnative_t i=0; i<NUCLEOTIDES_PER_WORD; i++)
+		keys[i]=previous_Word<<2*i<<2 | word>>(2*(NUCLEOTIDES_PER_WORD-1)-2*i);
+}
+
+
 // Function to use when sorting elements with qsort() later. Elements with
 // larger values will come first and in cases of identical values then elements
 // with smaller keys will come first.
@@ -60,50 +88,409 @@ static int element_Compare(const element * const left_Element
 }
 
 
-// Generate frequencies for all oligonucleotides in polynucleotide that are of
-// desired_Length_For_Oligonucleotides and then save it to output.
-static void generate_Frequencies_For_Desired_Length_Oligonucleotides(
-  const char * const polynucleotide, const intnative_t polynucleotide_Length
-  , const intnative_t desired_Length_For_Oligonucleotides, char * const output){
+// Oligonucleotides with up to this many nucleotides have few enough possible
+// keys (4^length) that they are counted in a dense array indexed directly by
+// key instead of in a hash table. This avoids the hashing, probing, and
+// resizing for the shorter lengths.
+#define MAXIMUM_DENSE_LENGTH 12
+
+// Dense arrays with up to this many elements are small enough to stay in cache
+// even with 32 bit counters. Larger dense arrays use 16 bit counters instead
+// to halve their size.
+#define MAXIMUM_DENSE_32_ELEMENTS ((intnative_t)1<<18)
+
+// Every thread gets its own copy of each dense array while counting so the
+// dense backends are only picked automatically while all of the copies of a
+// dense array fit in this many bytes. With 16 bit counters this allows lengths
+// up to 12 with one thread but only up to 10 with 32 threads, the longer
+// lengths use the hash tables instead.
+#define MAXIMUM_DENSE_BYTES ((intnative_t)1<<26)
+
+// The different ways that an oligonucleotide_Counter can store its counts.
+typedef enum {
+	// Dense array of 32 bit counts indexed by key.
+	COUNTER_BACKEND_DENSE_32,
+	// Dense array of 16 bit counts indexed by key. Every time a count wraps
+	// around to 0 the count for the key in hash_Tables is incremented so
+	// hash_Tables hold the number of times 65536 has been added to the count.
+	COUNTER_BACKEND_DENSE_16,
+	// Counts are only stored in hash_Tables.
+	COUNTER_BACKEND_HASH
+} counter_Backend;
+
+static const char * const counter_Backend_Names[]={"dense-32", "dense-16"
+  , "hash"};
+
+
+// Keys are split into this many ranges (by their most significant bits) and
+// each range gets its own hash table. This lets the hash tables and dense
+// arrays from different threads be merged in parallel by giving each range to
+// a different thread.
+#define KEY_RANGE_BITS 6
+#define KEY_RANGE_COUNT (1<<KEY_RANGE_BITS)
+
+// Each length of oligonucleotide that needs to be counted gets its own
+// oligonucleotide_Counter. All of the counters are filled in by a single pass
+// over polynucleotide (see count_Oligonucleotides() below) so that the large
+// polynucleotide only needs to be read from memory once instead of once for
+// every length.
+typedef struct {
+	intnative_t	length;
+	uint64_t	mask;
+	// Shifting a key right by key_Range_Shift gives the index of its range.
+	intnative_t	key_Range_Shift;
+	counter_Backend	backend;
+	uint32_t *	dense_32_Counts;
+	uint16_t *	dense_16_Counts;
+	khash_t(oligonucleotide) *	hash_Tables[KEY_RANGE_COUNT];
+} oligonucleotide_Counter;
+
+
+// Pick the fastest backend for counting oligonucleotides of length whose
+// arrays for all the threads fit in MAXIMUM_DENSE_BYTES.
+static counter_Backend select_Counter_Backend(const intnative_t length){
+	if(length>MAXIMUM_DENSE_LENGTH)
+		return COUNTER_BACKEND_HASH;
+	const intnative_t elements=(intnative_t)1<<2*length;
+	if(elements<=MAXIMUM_DENSE_32_ELEMENTS)
+		return COUNTER_BACKEND_DENSE_32;
+	if(omp_get_max_threads()*elements*(intnative_t)sizeof(uint16_t)
+	  <=MAXIMUM_DENSE_BYTES)
+		return COUNTER_BACKEND_DENSE_16;
+	return COUNTER_BACKEND_HASH;
+}
 
-	khash_t(oligonucleotide) * hash_Table=kh_init(oligonucleotide);
 
-	uint64_t key=0;
-	const uint64_t mask=((uint64_t)1<<2*desired_Length_For_Oligonucleotides)-1;
+// Initialize counter for counting all oligonucleotides of length using backend.
+// The dense backends can only be used for lengths up to MAXIMUM_DENSE_LENGTH.
+static void init_Oligonucleotide_Counter_With_Backend(
+  oligonucleotide_Counter * const counter, const intnative_t length
+  , const counter_Backend backend){
+	counter->length=length;
+	counter->mask=((uint64_t)1<<2*length)-1;
+	counter->key_Range_Shift=2*length>KEY_RANGE_BITS
+	  ? 2*length-KEY_RANGE_BITS : 0;
+	counter->backend=backend;
+	counter->dense_32_Counts=NULL;
+	counter->dense_16_Counts=NULL;
+	for(intnative_t i=0; i<KEY_RANGE_COUNT; i++)
+		counter->hash_Tables[i]=kh_init(oligonucleotide);
+
+	// Use calloc() so that the operating system can hand out already zeroed
+	// pages for the larger arrays.
+	if(backend==COUNTER_BACKEND_DENSE_32)
+		counter->dense_32_Counts=calloc(counter->mask+1, sizeof(uint32_t));
+	else if(backend==COUNTER_BACKEND_DENSE_16)
+		counter->dense_16_Counts=calloc(counter->mask+1, sizeof(uint16_t));
+}
+
+
+// Initialize counter for counting all oligonucleotides of length using the
+// backend picked by select_Counter_Backend().
+static void init_Oligonucleotide_Counter(oligonucleotide_Counter * const counter
+  , const intnative_t length){
+	init_Oligonucleotide_Counter_With_Backend(counter, length
+	  , select_Counter_Backend(length));
+}
+
+
+static void destroy_Oligonucleotide_Counter(
+  oligonucleotide_Counter * const counter){
+	free(counter->dense_32_Counts);
+	free(counter->dense_16_Counts);
+	for(intnative_t i=0; i<KEY_RANGE_COUNT; i++)
+		kh_destroy(oligonucleotide, counter->hash_Tables[i]);
+}
+
+
+// Add count to the count for key in hash_Table.
+static inline void add_To_Hash_Table_Count(
+  khash_t(oligonucleotide) * const hash_Table, const uint64_t key
+  , const uint32_t count){
+
+	int element_Was_Unused;
+	const khiter_t k=kh_put(oligonucleotide, hash_Table, key
+	  , &element_Was_Unused);
+
+	// If the element_Was_Unused, then initialize the count, otherwise add to
+	// the count.
+	if(element_Was_Unused)
+		kh_value(hash_Table, k)=count;
+	else
+		kh_value(hash_Table, k)+=count;
+}
+
+
+// Increment the count in counter for the oligonucleotides with the keys from
+// start up to (but not including) end. backend must be counter->backend and is
+// passed in as a constant by add_Keys_To_Counter() so that this gets inlined
+// into one loop for each backend without any switch inside of the loop.
+static inline __attribute__((always_inline)) void
+  add_Keys_To_Counter_With_Backend(oligonucleotide_Counter * const counter
+  , const uint64_t * const keys, const intnative_t start
+  , const intnative_t end, const counter_Backend backend){
+	const uint64_t mask=counter->mask;
+	const intnative_t key_Range_Shift=counter->key_Range_Shift;
+
+	for(intnative_t i=start; i<end; i++){
+		const uint64_t masked_Key=keys[i] & mask;
+		khash_t(oligonucleotide) * const hash_Table
+		  =counter->hash_Tables[masked_Key>>key_Range_Shift];
+
+		switch(backend){
+			case COUNTER_BACKEND_DENSE_32:
+				counter->dense_32_Counts[masked_Key]++;
+				break;
+			case COUNTER_BACKEND_DENSE_16:
+				// Record any overflow in hash_Table. This should be rare for
+				// the lengths that use this backend.
+				if(++counter->dense_16_Counts[masked_Key]==0)
+					add_To_Hash_Table_Count(hash_Table, masked_Key, 1);
+				break;
+			case COUNTER_BACKEND_HASH:
+				add_To_Hash_Table_Count(hash_Table, masked_Key, 1);
+				break;
+		}
+	}
+}
+
+
+// Increment the count in counter for the oligonucleotides with the keys from
+// start up to (but not including) end using the loop for counter's backend.
+static inline void add_Keys_To_Counter(oligonucleotide_Counter * const counter
+  , const uint64_t * const keys, const intnative_t start
+  , const intnative_t end){
+	switch(counter->backend){
+		case COUNTER_BACKEND_DENSE_32:
+			add_Keys_To_Counter_With_Backend(counter, keys, start, end
+			  , COUNTER_BACKEND_DENSE_32);
+			break;
+		case COUNTER_BACKEND_DENSE_16:
+			add_Keys_To_Counter_With_Backend(counter, keys, start, end
+			  , COUNTER_BACKEND_DENSE_16);
+			break;
+		case COUNTER_BACKEND_HASH:
+			add_Keys_To_Counter_With_Backend(counter, keys, start, end
+			  , COUNTER_BACKEND_HASH);
+			break;
+	}
+}
+
+
+// Get the count for the oligonucleotide with key from counter.
+static uint32_t get_Oligonucleotide_Count(
+  const oligonucleotide_Counter * const counter, const uint64_t key){
+
+	if(counter->backend==COUNTER_BACKEND_DENSE_32)
+		return counter->dense_32_Counts[key];
+
+	const khash_t(oligonucleotide) * const hash_Table
+	  =counter->hash_Tables[key>>counter->key_Range_Shift];
+	const khiter_t k=kh_get(oligonucleotide, hash_Table, key);
+	const uint32_t hash_Table_Count=k==kh_end(hash_Table)
+	  ? 0 : kh_value(hash_Table, k);
+
+	if(counter->backend==COUNTER_BACKEND_DENSE_16)
+		return (hash_Table_Count<<16) + counter->dense_16_Counts[key];
+	return hash_Table_Count;
+}
+
+
+// Create an array of elements for all the oligonucleotides in counter that
+// have a non-zero count. The number of elements is saved to elements_Count and
+// the array must be freed by the caller.
+static element * get_Oligonucleotide_Elements(
+  const oligonucleotide_Counter * const counter
+  , intnative_t * const elements_Count){
+	intnative_t i=0;
+	element * elements_Array;
+
+	if(counter->backend==COUNTER_BACKEND_HASH){
+		intnative_t elements_Array_Size=0;
+		for(intnative_t j=0; j<KEY_RANGE_COUNT; j++)
+			elements_Array_Size+=kh_size(counter->hash_Tables[j]);
+		elements_Array=malloc(elements_Array_Size*sizeof(element));
+
+		uint64_t key;
+		uint32_t value;
+		for(intnative_t j=0; j<KEY_RANGE_COUNT; j++)
+			kh_foreach(counter->hash_Tables[j], key, value
+			  , elements_Array[i++]=((element){key, value}));
+	}else{
+		elements_Array=malloc((counter->mask+1)*sizeof(element));
+		for(uint64_t key=0; key<=counter->mask; key++){
+			const uint32_t value=get_Oligonucleotide_Count(counter, key);
+			if(value)
+				elements_Array[i++]=((element){key, value});
+		}
+	}
+
+	*elements_Count=i;
+	return elements_Array;
+}
+
+
+// Count the oligonucleotides in polynucleotide that end at positions from
+// start_Position up to (but not including) end_Position for every one of the
+// counters at once. The keys for every position in a word are extracted
+// together and the key for each shorter length is just the low bits of the
+// same key, so each word only needs to be read once no matter how many lengths
+// are being counted. The keys of a word are then handed to each counter in
+// turn so that the backend of a counter is only checked once per word. The
+// longest length must be no more than NUCLEOTIDES_PER_WORD nucleotides.
+static void count_Oligonucleotides(const uint64_t * const polynucleotide
+  , const intnative_t start_Position, const intnative_t end_Position
+  , oligonucleotide_Counter * const counters, const intnative_t counter_Count){
+
+	uint64_t keys[NUCLEOTIDES_PER_WORD];
+
+	for(intnative_t word_Index=start_Position/NUCLEOTIDES_PER_WORD
+	  ; word_Index*NUCLEOTIDES_PER_WORD<end_Position; word_Index++){
+		const intnative_t word_Position=word_Index*NUCLEOTIDES_PER_WORD;
+
+		get_Oligonucleotide_Keys(word_Index ? polynucleotide[word_Index-1] : 0
+		  , polynucleotide[word_Index], keys);
+
+		// Only count the positions in this word that are in the range.
+		const intnative_t word_Start=start_Position>word_Position
+		  ? start_Position-word_Position : 0;
+		const intnative_t word_End=end_Position-word_Position
+		  <NUCLEOTIDES_PER_WORD ? end_Position-word_Position
+		  : NUCLEOTIDES_PER_WORD;
+
+		for(intnative_t j=0; j<counter_Count; j++){
+			// The first length-1 nucleotides of polynucleotide don't have a
+			// complete oligonucleotide ending at them yet.
+			const intnative_t first_Complete=counters[j].length-1-word_Position;
+			add_Keys_To_Counter(&counters[j], keys
+			  , first_Complete>word_Start ? first_Complete : word_Start
+			  , word_End);
+		}
+	}
+}
+
+
+// Add the counts for the keys in key_Range from each of the thread_Count
+// thread_Counters to counter. thread_Counters are laid out with stride
+// counters between the ones for each thread and must use the same length and
+// backend as counter. Different key ranges can be merged at the same time by
+// different threads since they don't share any elements of the dense arrays or
+// any of the hash tables.
+static void merge_Oligonucleotide_Counter_Key_Range(
+  oligonucleotide_Counter * const counter
+  , const oligonucleotide_Counter * const thread_Counters
+  , const intnative_t stride, const intnative_t thread_Count
+  , const intnative_t key_Range){
+
+	const uint64_t first_Key=(uint64_t)key_Range<<counter->key_Range_Shift;
+	if(first_Key>counter->mask)
+		return;
+	const uint64_t last_Key=first_Key+((uint64_t)1<<counter->key_Range_Shift)-1;
+
+	khash_t(oligonucleotide) * const hash_Table=counter->hash_Tables[key_Range];
+
+	if(counter->backend==COUNTER_BACKEND_DENSE_32){
+		for(uint64_t key=first_Key; key<=last_Key; key++){
+			uint32_t count=0;
+			for(intnative_t i=0; i<thread_Count; i++)
+				count+=thread_Counters[i*stride].dense_32_Counts[key];
+			counter->dense_32_Counts[key]=count;
+		}
+	}else if(counter->backend==COUNTER_BACKEND_DENSE_16){
+		for(uint64_t key=first_Key; key<=last_Key; key++){
+			uint32_t count=0;
+			for(intnative_t i=0; i<thread_Count; i++)
+				count+=thread_Counters[i*stride].dense_16_Counts[key];
+			counter->dense_16_Counts[key]=count;
+
+			// Anything that didn't fit in 16 bits overflows into hash_Table.
+			if(count>>16)
+				add_To_Hash_Table_Count(hash_Table, key, count>>16);
+		}
+	}
 
-	// For the first several nucleotides we only need to append them to key in
-	// preparation for the insertion of complete oligonucleotides to hash_Table.
-	for(intnative_t i=0; i<desired_Length_For_Oligonucleotides-1; i++)
-		key=(key<<2 & mask) | polynucleotide[i];
+	// Add in the hash tables. For the dense 16 bit backend these contain the
+	// overflow counts from each thread.
+	for(intnative_t i=0; i<thread_Count; i++){
+		uint64_t key;
+		uint32_t value;
+		kh_foreach(thread_Counters[i*stride].hash_Tables[key_Range], key, value
+		  , add_To_Hash_Table_Count(hash_Table, key, value));
+	}
+}
 
-	// Add all the complete oligonucleotides of
-	// desired_Length_For_Oligonucleotides to hash_Table and update the count
-	// for each oligonucleotide.
-	for(intnative_t i=desired_Length_For_Oligonucleotides-1
-	  ; i<polynucleotide_Length; i++){
 
-		key=(key<<2 & mask) | polynucleotide[i];
+// Count all the oligonucleotides in polynucleotide for every one of the
+// counters using all available threads. Each thread counts the
+// oligonucleotides ending in its own chunk of polynucleotide into its own set
+// of counters (the chunks overlap by one word so that the keys for the first
+// positions can be filled in) and then the thread counters are merged into
+// counters in parallel by key range.
+static void count_Oligonucleotides_In_Parallel(
+  const uint64_t * const polynucleotide
+  , const intnative_t polynucleotide_Length
+  , oligonucleotide_Counter * const counters, const intnative_t counter_Count){
+
+	// With only one thread just count directly into counters.
+	if(omp_get_max_threads()==1){
+		count_Oligonucleotides(polynucleotide, 0, polynucleotide_Length
+		  , counters, counter_Count);
+		return;
+	}
 
-		int element_Was_Unused;
-		const khiter_t k=kh_put(oligonucleotide, hash_Table, key
-		  , &element_Was_Unused);
+	oligonucleotide_Counter * const thread_Counters
+	  =malloc(omp_get_max_threads()*counter_Count
+	  *sizeof(oligonucleotide_Counter));
+	intnative_t thread_Count;
 
-		// If the element_Was_Unused, then initialize the count to 1, otherwise
-		// increment the count.
-		if(element_Was_Unused)
-			kh_value(hash_Table, k)=1;
-		else
-			kh_value(hash_Table, k)++;
+	#pragma omp parallel
+	{
+		#pragma omp single
+		thread_Count=omp_get_num_threads();
+
+		const intnative_t thread_Number=omp_get_thread_num();
+		oligonucleotide_Counter * const local_Counters
+		  =&thread_Counters[thread_Number*counter_Count];
+
+		// Each thread initializes its own counters so that their memory ends up
+		// close to the thread using it.
+		for(intnative_t i=0; i<counter_Count; i++)
+			init_Oligonucleotide_Counter_With_Backend(&local_Counters[i]
+			  , counters[i].length, counters[i].backend);
+
+		count_Oligonucleotides(polynucleotide
+		  , polynucleotide_Length*thread_Number/thread_Count
+		  , polynucleotide_Length*(thread_Number+1)/thread_Count
+		  , local_Counters, counter_Count);
 	}
 
-	// Create an array of elements from hash_Table.
-	intnative_t elements_Array_Size=kh_size(hash_Table), i=0;
-	element * elements_Array=malloc(elements_Array_Size*sizeof(element));
-	uint32_t value;
-	kh_foreach(hash_Table, key, value
-	  , elements_Array[i++]=((element){key, value}));
+	// Merge every key range of every counter. The key ranges can vary a lot in
+	// how many elements they have so hand them out dynamically.
+	#pragma omp parallel for schedule(dynamic)
+	for(intnative_t i=0; i<counter_Count*KEY_RANGE_COUNT; i++)
+		merge_Oligonucleotide_Counter_Key_Range(&counters[i/KEY_RANGE_COUNT]
+		  , &thread_Counters[i/KEY_RANGE_COUNT], counter_Count, thread_Count
+		  , i%KEY_RANGE_COUNT);
 
-	kh_destroy(oligonucleotide, hash_Table);
+	#pragma omp parallel for
+	for(intnative_t i=0; i<thread_Count*counter_Count; i++)
+		destroy_Oligonucleotide_Counter(&thread_Counters[i]);
+
+	free(thread_Counters);
+}
+
+
+// Generate frequencies for all oligonucleotides of the length counted by
+// counter and then save it to output.
+static void generate_Frequencies_For_Desired_Length_Oligonucleotides(
+  const oligonucleotide_Counter * const counter
+  , const intnative_t polynucleotide_Length, char * const output){
+	const intnative_t desired_Length_For_Oligonucleotides=counter->length;
+
+	// Create an array of elements from counter.
+	intnative_t elements_Array_Size;
+	element * elements_Array=get_Oligonucleotide_Elements(counter
+	  , &elements_Array_Size);
 
 	// Sort elements_Array.
 	qsort(elements_Array, elements_Array_Size, sizeof(element)
@@ -131,115 +518,311 @@ static void generate_Frequencies_For_Desired_Length_Oligonucleotides(
 }
 
 
-// Generate a count for the number of times oligonucleotide appears in
-// polynucleotide and then save it to output.
+// Generate a count for the number of times oligonucleotide appears using the
+// counter for oligonucleotides of its length and then save it to output.
 static void generate_Count_For_Oligonucleotide(
-  const char * const polynucleotide, const intnative_t polynucleotide_Length
+  const oligonucleotide_Counter * const counter
   , const char * const oligonucleotide, char * const output){
 	const intnative_t oligonucleotide_Length=strlen(oligonucleotide);
 
-	khash_t(oligonucleotide) * const hash_Table=kh_init(oligonucleotide);
-
+	// Generate the key for oligonucleotide.
 	uint64_t key=0;
-	const uint64_t mask=((uint64_t)1<<2*oligonucleotide_Length)-1;
+	for(intnative_t i=0; i<oligonucleotide_Length; i++)
+		key=(key<<2) | code_For_Nucleotide(oligonucleotide[i]);
 
-	// For the first several nucleotides we only need to append them to key in
-	// preparation for the insertion of complete oligonucleotides to hash_Table.
-	for(intnative_t i=0; i<oligonucleotide_Length-1; i++)
-		key=(key<<2 & mask) | polynucleotide[i];
+	// Output the count for oligonucleotide to output.
+	uintmax_t count=get_Oligonucleotide_Count(counter, key);
+	snprintf(output, MAXIMUM_OUTPUT_LENGTH, "%ju\t%s", count, oligonucleotide);
+}
 
-	// Add all the complete oligonucleotides of oligonucleotide_Length to
-	// hash_Table and update the count for each oligonucleotide.
-	for(intnative_t i=oligonucleotide_Length-1; i<polynucleotide_Length; i++){
 
-		key=(key<<2 & mask) | polynucleotide[i];
+// Get the current time in seconds from a monotonic clock.
+static double get_Time(){
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec+time.tv_nsec*1e-9;
+}
 
-		int element_Was_Unused;
-		const khiter_t k=kh_put(oligonucleotide, hash_Table, key
-		  , &element_Was_Unused);
 
-		// If the element_Was_Unused, then initialize the count to 1, otherwise
-		// increment the count.
-		if(element_Was_Unused)
-			kh_value(hash_Table, k)=1;
-		else
-			kh_value(hash_Table, k)++;
+// Time counting the oligonucleotides in polynucleotide of each of the
+// oligonucleotide_Lengths with every backend that supports that length and
+// print the results to stdout. The backend that would be picked automatically
+// by select_Counter_Backend() is marked with a '*'.
+static void benchmark_Counter_Backends(const uint64_t * const polynucleotide
+  , const intnative_t polynucleotide_Length
+  , const intnative_t * const oligonucleotide_Lengths
+  , const intnative_t oligonucleotide_Lengths_Count){
+
+	printf("length\tbackend\tseconds\tdistinct\n");
+	for(intnative_t i=0; i<oligonucleotide_Lengths_Count; i++){
+		const intnative_t length=oligonucleotide_Lengths[i];
+
+		for(counter_Backend backend=COUNTER_BACKEND_DENSE_32
+		  ; backend<=COUNTER_BACKEND_HASH; backend++){
+			if(backend!=COUNTER_BACKEND_HASH && length>MAXIMUM_DENSE_LENGTH)
+				continue;
+
+			oligonucleotide_Counter counter;
+			const double start_Time=get_Time();
+			init_Oligonucleotide_Counter_With_Backend(&counter, length
+			  , backend);
+			count_Oligonucleotides_In_Parallel(polynucleotide
+			  , polynucleotide_Length, &counter, 1);
+			const double elapsed_Time=get_Time()-start_Time;
+
+			// Make sure that every oligonucleotide was counted.
+			intnative_t elements_Count, total_Count=0;
+			element * elements_Array=get_Oligonucleotide_Elements(&counter
+			  , &elements_Count);
+			for(intnative_t j=0; j<elements_Count; j++)
+				total_Count+=elements_Array[j].value;
+			free(elements_Array);
+			if(total_Count!=polynucleotide_Length-length+1)
+				fprintf(stderr, "Wrong total count for length %jd with %s.\n"
+				  , (intmax_t)length, counter_Backend_Names[backend]);
+
+			printf("%jd\t%s%s\t%.3f\t%jd\n", (intmax_t)length
+			  , counter_Backend_Names[backend]
+			  , backend==select_Counter_Backend(length) ? "*" : ""
+			  , elapsed_Time, (intmax_t)elements_Count);
+
+			destroy_Oligonucleotide_Counter(&counter);
+		}
 	}
+}
 
-	// Generate the key for oligonucleotide.
-	key=0;
-	for(intnative_t i=0; i<oligonucleotide_Length; i++)
-		key=(key<<2) | code_For_Nucleotide(oligonucleotide[i]);
 
-	// Output the count for oligonucleotide to output.
-	khiter_t k=kh_get(oligonucleotide, hash_Table, key);
-	uintmax_t count=k==kh_end(hash_Table) ? 0 : kh_value(hash_Table, k);
-	snprintf(output, MAXIMUM_OUTPUT_LENGTH, "%ju\t%s", count, oligonucleotide);
+// Input is read in blocks of this many bytes when it can't be mapped.
+#define INPUT_BLOCK_SIZE 16777216
+
+// Get all of stdin in memory and save its size to input_Length. If stdin is a
+// regular file then it is mapped into memory instead of being copied so that
+// the operating system can read it in directly. Otherwise it is read in large
+// blocks. input_Is_Mapped is set to indicate which one happened so that the
+// caller knows whether to use munmap() or free() when done with the input.
+static char * get_Input(intnative_t * const input_Length
+  , int * const input_Is_Mapped){
+
+	struct stat input_Status;
+	if(!fstat(STDIN_FILENO, &input_Status) && S_ISREG(input_Status.st_mode)
+	  && input_Status.st_size>0){
+		char * const input=mmap(NULL, input_Status.st_size, PROT_READ
+		  , MAP_PRIVATE, STDIN_FILENO, 0);
+		if(input!=MAP_FAILED){
+			madvise(input, input_Status.st_size, MADV_SEQUENTIAL);
+			*input_Length=input_Status.st_size;
+			*input_Is_Mapped=1;
+			return input;
+		}
+	}
+
+	intnative_t input_Capacity=INPUT_BLOCK_SIZE, bytes_Read;
+	char * input=malloc(input_Capacity);
+	*input_Length=0;
+	while((bytes_Read=read(STDIN_FILENO, input+*input_Length
+	  , input_Capacity-*input_Length))>0)
+		if((*input_Length+=bytes_Read)==input_Capacity)
+			input=realloc(input, input_Capacity*=2);
+
+	*input_Is_Mapped=0;
+	return input;
+}
+
+
+// Convert nucleotides_Count nucleotide characters to codes and save them to
+// codes. This does the same thing as code_For_Nucleotide() but only with bit
+// operations instead of a table lookup so that the compiler can vectorize it.
+// Bits 1 and 2 of the characters are 00 for 'A', 01 for 'C', 11 for 'G', and 10
+// for 'T' and XORing the high bit of that into the low bit gives their codes.
+static void encode_Nucleotides(const char * const nucleotides
+  , const intnative_t nucleotides_Count, uint8_t * const codes){
+	for(intnative_t i=0; i<nucleotides_Count; i++){
+		const uint8_t bits=nucleotides[i]>>1 & 0x3;
+		codes[i]=bits ^ bits>>1;
+	}
+}
+
+
+// Pack words_Count*NUCLEOTIDES_PER_WORD codes into words_Count words of
+// polynucleotide.
+static void pack_Nucleotide_Codes(const uint8_t * const codes
+  , const intnative_t words_Count, uint64_t * const polynucleotide){
+	for(intnative_t i=0; i<words_Count; i++){
+		uint64_t word=0;
+		for(intnative_t j=0; j<NUCLEOTIDES_PER_WORD; j++)
+			word|=(uint64_t)codes[i*NUCLEOTIDES_PER_WORD+j]
+			  <<2*(NUCLEOTIDES_PER_WORD-1-j);
+		polynucleotide[i]=word;
+	}
+}
+
+
+// Nucleotides are encoded into a buffer of this many codes before being packed.
+// Must be a multiple of NUCLEOTIDES_PER_WORD.
+#define CODES_BUFFER_SIZE 65536
+
+// Find the third polynucleotide in input, strip out the newlines, and then
+// encode and pack it. The number of nucleotides in it is saved to
+// polynucleotide_Length.
+static uint64_t * get_Third_Polynucleotide(const char * const input
+  , const intnative_t input_Length, intnative_t * const polynucleotide_Length){
+
+	const char * const input_End=input+input_Length;
+
+	// Find the start of the third polynucleotide which is the line after its
+	// header.
+	const char * position=NULL;
+	if(input_Length>=sizeof(">THREE")-1
+	  && !memcmp(input, ">THREE", sizeof(">THREE")-1))
+		position=input;
+	else if((position=memmem(input, input_Length, "\n>THREE"
+	  , sizeof("\n>THREE")-1)))
+		position++;
+	if(position && (position=memchr(position, '\n', input_End-position)))
+		position++;
+	else
+		position=input_End;
+
+	// The third polynucleotide ends at the next header or at the end of input.
+	const char * polynucleotide_End=memmem(position, input_End-position, "\n>"
+	  , sizeof("\n>")-1);
+	if(!polynucleotide_End)
+		polynucleotide_End=input_End;
+
+	// The polynucleotide can't have more nucleotides than there are characters
+	// left so that is enough memory for it.
+	uint64_t * const polynucleotide=malloc(((polynucleotide_End-position)
+	  /NUCLEOTIDES_PER_WORD+1)*sizeof(uint64_t));
+	intnative_t words_Count=0;
+
+	uint8_t codes[CODES_BUFFER_SIZE];
+	intnative_t codes_Count=0;
+
+	// Go through each line, encoding the nucleotides in it into codes and then
+	// packing codes into polynucleotide whenever it fills up. memchr() is used
+	// to find the newlines since it is already vectorized.
+	while(position<polynucleotide_End){
+		const char * line_End=memchr(position, '\n'
+		  , polynucleotide_End-position);
+		if(!line_End)
+			line_End=polynucleotide_End;
+
+		while(position<line_End){
+			intnative_t nucleotides_Count=line_End-position;
+			if(nucleotides_Count>CODES_BUFFER_SIZE-codes_Count)
+				nucleotides_Count=CODES_BUFFER_SIZE-codes_Count;
+
+			encode_Nucleotides(position, nucleotides_Count, codes+codes_Count);
+			codes_Count+=nucleotides_Count;
+			position+=nucleotides_Count;
+
+			if(codes_Count==CODES_BUFFER_SIZE){
+				pack_Nucleotide_Codes(codes
+				  , CODES_BUFFER_SIZE/NUCLEOTIDES_PER_WORD
+				  , polynucleotide+words_Count);
+				words_Count+=CODES_BUFFER_SIZE/NUCLEOTIDES_PER_WORD;
+				codes_Count=0;
+			}
+		}
+
+		position=line_End+1;
+	}
+
+	*polynucleotide_Length=words_Count*NUCLEOTIDES_PER_WORD+codes_Count;
 
-	kh_destroy(oligonucleotide, hash_Table);
+	// Pad out the remaining codes with zeros to fill the last word and then
+	// pack them too.
+	const intnative_t remaining_Words_Count
+	  =(codes_Count+NUCLEOTIDES_PER_WORD-1)/NUCLEOTIDES_PER_WORD;
+	memset(codes+codes_Count, 0
+	  , remaining_Words_Count*NUCLEOTIDES_PER_WORD-codes_Count);
+	pack_Nucleotide_Codes(codes, remaining_Words_Count
+	  , polynucleotide+words_Count);
+
+	return polynucleotide;
 }
 
 
-int main(){
-	char buffer[4096];
+// If the program is run with "benchmark" as its argument then instead of the
+// normal output, the time it takes to count each length with each of the
+// counter backends is output. Otherwise the time taken to read in the
+// polynucleotide and the time taken to count it are also output to stderr.
+int main(int argc, char * argv[]){
+	const double ingest_Start_Time=get_Time();
+
+	intnative_t input_Length;
+	int input_Is_Mapped;
+	char * const input=get_Input(&input_Length, &input_Is_Mapped);
+
+	intnative_t polynucleotide_Length;
+	uint64_t * const polynucleotide=get_Third_Polynucleotide(input
+	  , input_Length, &polynucleotide_Length);
 
-	// Find the start of the third polynucleotide.
-	while(fgets(buffer, sizeof(buffer), stdin) && memcmp(">THREE", buffer
-	  , sizeof(">THREE")-1));
+	if(input_Is_Mapped)
+		munmap(input, input_Length);
+	else
+		free(input);
 
-	// Start with 1 MB of storage for reading in the polynucleotide and grow
-	// geometrically.
-	intnative_t polynucleotide_Capacity=1048576;
-	intnative_t polynucleotide_Length=0;
-	char * polynucleotide=malloc(polynucleotide_Capacity);
+	const double ingest_Time=get_Time()-ingest_Start_Time;
 
-	// Start reading and encoding the third polynucleotide.
-	while(fgets(buffer, sizeof(buffer), stdin) && buffer[0]!='>'){
-		for(intnative_t i=0; buffer[i]!='\0'; i++)
-			if(buffer[i]!='\n')
-				polynucleotide[polynucleotide_Length++]
-				  =code_For_Nucleotide(buffer[i]);
+	// Lengths of the oligonucleotides to count.
+	static const intnative_t oligonucleotide_Lengths[]={1, 2, 3, 4, 6, 12, 18};
+	enum {COUNTER_COUNT=sizeof(oligonucleotide_Lengths)/sizeof(intnative_t)};
 
-		// Make sure we still have enough memory allocated for any potential
-		// nucleotides in the next line.
-		if(polynucleotide_Capacity-polynucleotide_Length<sizeof(buffer))
-			polynucleotide=realloc(polynucleotide, polynucleotide_Capacity*=2);
+	if(argc>1 && !strcmp(argv[1], "benchmark")){
+		benchmark_Counter_Backends(polynucleotide, polynucleotide_Length
+		  , oligonucleotide_Lengths, COUNTER_COUNT);
+		free(polynucleotide);
+		return 0;
 	}
 
-	// Free up any leftover memory.
-	polynucleotide=realloc(polynucleotide, polynucleotide_Length);
+	oligonucleotide_Counter counters[COUNTER_COUNT];
+	for(intnative_t i=0; i<COUNTER_COUNT; i++)
+		init_Oligonucleotide_Counter(&counters[i], oligonucleotide_Lengths[i]);
 
-	char output_Buffer[7][MAXIMUM_OUTPUT_LENGTH];
+	// Count the oligonucleotides for all lengths in one pass.
+	const double counting_Start_Time=get_Time();
+	count_Oligonucleotides_In_Parallel(polynucleotide, polynucleotide_Length
+	  , counters, COUNTER_COUNT);
+	const double counting_Time=get_Time()-counting_Start_Time;
 
-	// Do the following functions in parallel.
+	char output_Buffer[COUNTER_COUNT][MAXIMUM_OUTPUT_LENGTH];
+
+	// Generate the output for each length in parallel.
 	#pragma omp parallel sections
 	{
 		#pragma omp section
-		generate_Count_For_Oligonucleotide(polynucleotide
-		  , polynucleotide_Length, "GGTATTTTAATTTATAGT", output_Buffer[6]);
+		generate_Count_For_Oligonucleotide(&counters[6]
+		  , "GGTATTTTAATTTATAGT", output_Buffer[6]);
 		#pragma omp section
-		generate_Count_For_Oligonucleotide(polynucleotide
-		  , polynucleotide_Length, "GGTATTTTAATT", output_Buffer[5]);
+		generate_Count_For_Oligonucleotide(&counters[5], "GGTATTTTAATT"
+		  , output_Buffer[5]);
 		#pragma omp section
-		generate_Count_For_Oligonucleotide(polynucleotide
-		  , polynucleotide_Length, "GGTATT", output_Buffer[4]);
+		generate_Count_For_Oligonucleotide(&counters[4], "GGTATT"
+		  , output_Buffer[4]);
 		#pragma omp section
-		generate_Count_For_Oligonucleotide(polynucleotide
-		  , polynucleotide_Length, "GGTA", output_Buffer[3]);
+		generate_Count_For_Oligonucleotide(&counters[3], "GGTA"
+		  , output_Buffer[3]);
 		#pragma omp section
-		generate_Count_For_Oligonucleotide(polynucleotide
-		  , polynucleotide_Length, "GGT", output_Buffer[2]);
+		generate_Count_For_Oligonucleotide(&counters[2], "GGT"
+		  , output_Buffer[2]);
 
 		#pragma omp section
-		generate_Frequencies_For_Desired_Length_Oligonucleotides(polynucleotide
-		  , polynucleotide_Length, 2, output_Buffer[1]);
+		generate_Frequencies_For_Desired_Length_Oligonucleotides(&counters[1]
+		  , polynucleotide_Length, output_Buffer[1]);
 		#pragma omp section
-		generate_Frequencies_For_Desired_Length_Oligonucleotides(polynucleotide
-		  , polynucleotide_Length, 1, output_Buffer[0]);
+		generate_Frequencies_For_Desired_Length_Oligonucleotides(&counters[0]
+		  , polynucleotide_Length, output_Buffer[0]);
 	}
 
+	for(intnative_t i=0; i<COUNTER_COUNT; i++)
+		destroy_Oligonucleotide_Counter(&counters[i]);
+
 	// Output the results to stdout.
-	for(intnative_t i=0; i<7; printf("%s\n", output_Buffer[i++]));
+	for(intnative_t i=0; i<COUNTER_COUNT; printf("%s\n", output_Buffer[i++]));
+
+	fprintf(stderr, "Ingest time: %.3f s\nCounting time: %.3f s\n"
+	  , ingest_Time, counting_Time);
 
 	free(polynucleotide);
 